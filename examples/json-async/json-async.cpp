@@ -0,0 +1,123 @@
+
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either
+ version 2 of the License, or (at your option) any later
+ version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ Commercial use other than under the terms of the GNU General Public
+ License is allowed only after express negotiation of conditions
+ with the authors.
+*/
+
+#include "JsonAsync.h"
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+using json = nlohmann::json;
+
+// event loop single thread, come quello dell'applicazione: esegue i task postati finché ce ne sono in sospeso
+class EventLoop : public JsonExecutor
+{
+public:
+	void post(function<void()> task) override
+	{
+		{
+			lock_guard<mutex> locker(_mutex);
+			_tasks.push_back(std::move(task));
+		}
+		_condition.notify_one();
+	}
+
+	void run(const function<bool()> &done)
+	{
+		CurrentScope currentScope(this);
+		while (!done())
+		{
+			function<void()> task;
+			{
+				unique_lock<mutex> locker(_mutex);
+				_condition.wait(locker, [this]() { return !_tasks.empty(); });
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	thread::id threadId = this_thread::get_id();
+
+private:
+	mutex _mutex;
+	condition_variable _condition;
+	deque<function<void()>> _tasks;
+};
+
+// coroutine "fire and forget" minimale
+struct Task
+{
+	struct promise_type
+	{
+		Task get_return_object() { return {}; }
+		suspend_never initial_suspend() noexcept { return {}; }
+		suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { terminate(); }
+	};
+};
+
+Task loadAll(EventLoop &loop, const string &pathName, bool &done)
+{
+	json root = co_await JsonAsync::parseAsync<json>(R"({"name": "async", "values": [1, 2, 3]})");
+	cout << "parseAsync: " << JSONUtils::toString(root) << ", resumed on the loop thread: " << (this_thread::get_id() == loop.threadId) << endl;
+
+	json configuration = co_await JsonAsync::loadConfigurationFileAsync<json>(pathName);
+	cout << "loadConfigurationFileAsync: port " << JSONUtils::as<int32_t>(configuration, "port")
+		 << ", resumed on the loop thread: " << (this_thread::get_id() == loop.threadId) << endl;
+
+	try
+	{
+		co_await JsonAsync::parseAsync<json>("{not json");
+	}
+	catch (const exception &e)
+	{
+		cout << "parseAsync error: " << e.what() << endl;
+	}
+
+	done = true;
+}
+
+int main()
+{
+	const string pathName = (filesystem::temp_directory_path() / "json-async.json").string();
+	{
+		ofstream file(pathName);
+		file << R"({
+			// commento
+			"port": 8080
+		})";
+	}
+
+	EventLoop loop;
+	bool done = false;
+	{
+		JsonExecutor::CurrentScope currentScope(&loop);
+		loadAll(loop, pathName, done);
+	}
+	loop.run([&done]() { return done; });
+
+	filesystem::remove(pathName);
+
+	return 0;
+}
@@ -72,10 +72,20 @@ int main()
 		// cout << "exception: " << e.what() << endl << endl;
 	}
 
-	for (auto& item : JsonPath(&root)["list"].as<json>(json::array()))
+	for (const auto& item : JsonPath(&root)["list"].elements())
 	{
-		cout << "item: " << JsonPath(&item).as<int32_t>(-1) << endl;
+		cout << "item: " << item.path() << " -> " << item.as<int32_t>(-1) << endl;
 	}
+
+	for (const auto& [key, value] : JsonPath(&root)["key2"]["key3"].members())
+	{
+		cout << "member: " << key << " -> " << value.as<int32_t>(-1) << endl;
+	}
+
+	cout << "keys:";
+	for (const string_view key : JsonPath(&root).keysView())
+		cout << " " << key;
+	cout << endl;
 	/*
 	cout << "key1" << endl;
 	cout << "val: " << JSONUtils::as<string>(root, "key1", "ciao") << endl << endl;
@@ -0,0 +1,104 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either
+ version 2 of the License, or (at your option) any later
+ version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ Commercial use other than under the terms of the GNU General Public
+ License is allowed only after express negotiation of conditions
+ with the authors.
+*/
+
+#include "JsonRecord.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace std;
+using json = nlohmann::json;
+
+// conta i byte allocati per confrontare la memoria per record
+static atomic<int64_t> allocatedBytes{0};
+
+void *operator new(size_t size)
+{
+	auto *p = static_cast<size_t *>(malloc(size + sizeof(size_t)));
+	if (p == nullptr)
+		throw bad_alloc();
+	*p = size;
+	allocatedBytes += static_cast<int64_t>(size);
+	return p + 1;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+	auto *p = static_cast<size_t *>(ptr) - 1;
+	allocatedBytes -= static_cast<int64_t>(*p);
+	free(p);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+int main()
+{
+	constexpr int recordsNumber = 100000;
+
+	auto makeRecord = [](const int index)
+	{
+		json record;
+		record["customerIdentifier"] = index;
+		record["customerName"] = "customer " + to_string(index);
+		record["creationTimestamp"] = 1700000000 + index;
+		record["lastUpdateTimestamp"] = 1700000500 + index;
+		record["deliveryCountry"] = "IT";
+		record["deliveryPostalCode"] = "00100";
+		record["paymentMethod"] = "card";
+		record["orderTotalAmount"] = index * 1.5;
+		record["orderCurrency"] = "EUR";
+		record["isPriorityCustomer"] = index % 2 == 0;
+		record["warehouseIdentifier"] = index % 16;
+		record["shippingStatus"] = "shipped";
+		record["server"] = {{"hostname", "db1"}, {"port", 5432}};
+		return record;
+	};
+
+	int64_t before = allocatedBytes;
+	vector<json> jsonRecords;
+	jsonRecords.reserve(recordsNumber);
+	for (int index = 0; index < recordsNumber; index++)
+		jsonRecords.push_back(makeRecord(index));
+	const int64_t jsonBytes = allocatedBytes - before;
+
+	before = allocatedBytes;
+	vector<JsonRecord<json>> records;
+	records.reserve(recordsNumber);
+	for (int index = 0; index < recordsNumber; index++)
+		records.emplace_back(makeRecord(index));
+	const int64_t recordBytes = allocatedBytes - before;
+
+	cout << "json:       " << jsonBytes / recordsNumber << " bytes per record" << endl;
+	cout << "JsonRecord: " << recordBytes / recordsNumber << " bytes per record" << endl;
+	cout << "keys: " << JsonKeyPool::shared().keysNumber() << ", shapes: " << JsonKeyPool::shared().shapesNumber() << endl;
+
+	const JsonRecord<json> &record = records[42];
+	cout << "customerName: " << record.as<string>("customerName") << endl;
+	cout << "orderTotalAmount: " << record.as<double>("orderTotalAmount", 0.0) << endl;
+	cout << "missing: " << record.as<int32_t>("missing", -1) << ", isPresent: " << record.isPresent("missing") << endl;
+	cout << "server.port: " << record["server"]["port"].as<int32_t>(80) << endl;
+	cout << "same as json: " << (record.toJson() == jsonRecords[42]) << endl;
+
+	return 0;
+}
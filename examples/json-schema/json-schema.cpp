@@ -0,0 +1,62 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either
+ version 2 of the License, or (at your option) any later
+ version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ Commercial use other than under the terms of the GNU General Public
+ License is allowed only after express negotiation of conditions
+ with the authors.
+*/
+
+#include "JsonSchema.h"
+#include <iostream>
+
+using namespace std;
+using json = nlohmann::json;
+
+static void printViolations(const string &title, const vector<JsonSchema::Violation> &violations)
+{
+	cout << title << ": " << (violations.empty() ? "valid" : to_string(violations.size()) + " violations") << endl;
+	for (const auto &violation : violations)
+		cout << "    " << violation.path << ": " << violation.message << endl;
+}
+
+int main()
+{
+	const JsonSchema schema = JsonSchema::compile(JSONUtils::toJson<json>(R"({
+		"type": "object",
+		"required": ["hostname", "port"],
+		"properties": {
+			"hostname": {"type": "string", "pattern": "^[a-z0-9.-]+$", "maxLength": 253},
+			"port": {"type": "integer", "minimum": 1, "maximum": 65535},
+			"tags": {"type": "array", "items": {"type": "string", "pattern": "^[a-z]+$"}, "uniqueItems": true},
+			"protocol": {"enum": ["http", "https"]}
+		},
+		"additionalProperties": false
+	})"));
+
+	printViolations("valid server", schema.validate(JSONUtils::toJson<json>(R"({"hostname": "db1.local", "port": 5432, "tags": ["db"]})")));
+	printViolations("invalid server", schema.validate(JSONUtils::toJson<json>(
+		R"({"hostname": "DB1", "port": 70000, "tags": ["db", 1, "db"], "protocol": "ftp", "user": "root"})"
+	)));
+
+	// stringhe molto lunghe: il pattern non deve esaurire lo stack
+	json longTags = json::object();
+	longTags["hostname"] = "db1";
+	longTags["port"] = 5432;
+	longTags["tags"] = {string(100000, 'a'), string(100000, 'a') + "1"};
+	printViolations("long tags", schema.validate(longTags));
+
+	return 0;
+}
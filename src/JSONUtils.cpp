@@ -1,7 +1,15 @@
+#define JSONUTILS_INSTANTIATION
 #include "JSONUtils.h"
+#include "Json5Reader.h"
+#include "JsonAsync.h"
+#include "JsonPath.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <format>
 #include <fstream>
 #include <regex>
+#include <thread>
 
 #ifdef _WIN32
 	extern char **_environ;
@@ -10,6 +18,57 @@ extern char **environ;
 #endif
 
 
+JSONUTILS_INSTANTIATE(, nlohmann::json)
+JSONUTILS_INSTANTIATE(, nlohmann::ordered_json)
+#undef JSONUTILS_INSTANTIATE_AS
+#undef JSONUTILS_INSTANTIATE
+
+template class JsonPath<nlohmann::json>;
+template class JsonPath<nlohmann::ordered_json>;
+
+void JSONUtils::handleError(const std::string &errorMessage, const bool exceptionOnError)
+{
+	if (exceptionOnError)
+	{
+		LOG_ERROR(errorMessage);
+		throw std::invalid_argument(errorMessage);
+	}
+	LOG_TRACE(errorMessage);
+}
+
+void JSONUtils::handleFieldNotFound(const std::string_view field, const bool exceptionOnError)
+{
+	const std::string errorMessage = std::format("Field [{}] not found", field);
+	if (exceptionOnError)
+	{
+		LOG_ERROR(errorMessage);
+		throw JsonFieldNotFound(errorMessage);
+	}
+	LOG_TRACE(errorMessage);
+}
+
+void JSONUtils::handleException(const std::string &json, const std::string_view field, const std::exception &e, const bool exceptionOnError)
+{
+	std::string errorMessage;
+	if (json.empty())
+		errorMessage = std::format("Field: {}, exception: {}", field, e.what());
+	else if (field.empty())
+		errorMessage = std::format("json: {}, exception: {}", json, e.what());
+	else
+		errorMessage = std::format("json: {}, field: {}, exception: {}", json, field, e.what());
+	if (exceptionOnError)
+	{
+		LOG_ERROR(errorMessage);
+		throw;
+	}
+	LOG_TRACE(errorMessage);
+}
+
+std::string JSONUtils::invalidValueMessage(const std::string_view value, const std::string_view field, const std::vector<std::string> &allowedValues)
+{
+	return fmt::format("Invalid value '{}' for '{}'. Allowed values are: {}", value, field, fmt::join(allowedValues, ", "));
+}
+
 // Rimuove commenti singola riga e multi-riga
 std::string JSONUtils::json5_removeComments(const std::string &input)
 {
@@ -75,3 +134,821 @@ std::string JSONUtils::applyEnvironmentToConfiguration(std::string configuration
 
 	return configuration;
 }
+
+namespace
+{
+// '*' qualunque sequenza (anche vuota), '?' un carattere
+bool wildcardMatch(std::string_view text, std::string_view pattern)
+{
+	size_t textIndex = 0;
+	size_t patternIndex = 0;
+	size_t starIndex = std::string_view::npos;
+	size_t starTextIndex = 0;
+	while (textIndex < text.size())
+	{
+		if (patternIndex < pattern.size() && (pattern[patternIndex] == '?' || pattern[patternIndex] == text[textIndex]))
+		{
+			textIndex++;
+			patternIndex++;
+		}
+		else if (patternIndex < pattern.size() && pattern[patternIndex] == '*')
+		{
+			starIndex = patternIndex++;
+			starTextIndex = textIndex;
+		}
+		else if (starIndex != std::string_view::npos)
+		{
+			patternIndex = starIndex + 1;
+			textIndex = ++starTextIndex;
+		}
+		else
+			return false;
+	}
+	while (patternIndex < pattern.size() && pattern[patternIndex] == '*')
+		patternIndex++;
+	return patternIndex == pattern.size();
+}
+
+// handler SAX che costruisce il DOM per Json5Reader (solo l'interfaccia pubblica di nlohmann::json_sax)
+template <typename J>
+class Json5DomBuilder
+{
+public:
+	explicit Json5DomBuilder(J &root) : _root(root) {}
+
+	bool null() { return add(nullptr); }
+	bool boolean(const bool value) { return add(value); }
+	bool number_integer(const typename J::number_integer_t value) { return add(value); }
+	bool number_unsigned(const typename J::number_unsigned_t value) { return add(value); }
+	bool number_float(const typename J::number_float_t value, const typename J::string_t &) { return add(value); }
+	bool string(typename J::string_t &value) { return add(std::move(value)); }
+
+	bool start_object(std::size_t)
+	{
+		_containers.push_back(add(J::object()));
+		return true;
+	}
+
+	bool key(typename J::string_t &key)
+	{
+		_member = &(*_containers.back())[key];
+		return true;
+	}
+
+	bool end_object()
+	{
+		_containers.pop_back();
+		return true;
+	}
+
+	bool start_array(std::size_t)
+	{
+		_containers.push_back(add(J::array()));
+		return true;
+	}
+
+	bool end_array()
+	{
+		_containers.pop_back();
+		return true;
+	}
+
+private:
+	J &_root;
+	std::vector<J *> _containers;
+	J *_member = nullptr; // valore della chiave appena letta
+
+	template <typename Value>
+	J *add(Value &&value)
+	{
+		if (_containers.empty())
+		{
+			_root = J(std::forward<Value>(value));
+			return &_root;
+		}
+		if (_containers.back()->is_array())
+		{
+			_containers.back()->emplace_back(std::forward<Value>(value));
+			return &_containers.back()->back();
+		}
+		*_member = J(std::forward<Value>(value));
+		return _member;
+	}
+};
+} // namespace
+
+std::vector<std::string> JSONUtils::configurationDirectoryFiles(const std::string_view &configurationDirectory, const std::string_view &glob)
+{
+	std::vector<std::string> pathNames;
+	try
+	{
+		for (const auto &entry : std::filesystem::directory_iterator(configurationDirectory))
+		{
+			if (entry.is_regular_file() && wildcardMatch(entry.path().filename().string(), glob))
+				pathNames.push_back(entry.path().string());
+		}
+	}
+	catch (const std::filesystem::filesystem_error &e)
+	{
+		const std::string errorMessage = std::format("Configuration directory cannot be read"
+			", configurationDirectory: {}"
+			", exception: {}", configurationDirectory, e.what());
+		LOG_ERROR(errorMessage);
+		throw std::runtime_error(errorMessage);
+	}
+
+	// ordine deterministico per il merge
+	std::ranges::sort(pathNames);
+	return pathNames;
+}
+
+template <typename J>
+J JSONUtils::loadJson5ConfigurationFile(const std::string_view &configurationPathName, const std::string_view &environmentPrefix)
+{
+	std::filebuf configurationFile;
+	if (!configurationFile.open(std::string(configurationPathName), std::ios::in | std::ios::binary))
+	{
+		const std::string errorMessage = std::format("Configuration file cannot be opened"
+			", configurationPathName: {}", configurationPathName);
+		LOG_ERROR(errorMessage);
+		throw std::runtime_error(errorMessage);
+	}
+
+	J root;
+	Json5DomBuilder<J> domBuilder(root);
+	try
+	{
+		Json5Reader(configurationFile, environmentPrefix, configurationPathName).parse(domBuilder);
+	}
+	catch (const std::exception &e)
+	{
+		LOG_ERROR(e.what());
+		throw;
+	}
+	return root;
+}
+
+template nlohmann::json JSONUtils::loadJson5ConfigurationFile<nlohmann::json>(const std::string_view &, const std::string_view &);
+template nlohmann::ordered_json JSONUtils::loadJson5ConfigurationFile<nlohmann::ordered_json>(const std::string_view &, const std::string_view &);
+
+namespace
+{
+constexpr std::size_t toStringParallelMinElements = 4096;
+constexpr std::size_t toStringParallelMinChunkElements = 256;
+// oltre questa profondità i contenitori piccoli vengono serializzati senza cercare figli grandi
+constexpr std::size_t toStringParallelMaxDepth = 4;
+
+// chiave di un oggetto come la scrive dump (ensure_ascii): le chiavi ASCII senza caratteri da escapare
+// (il caso comune) vengono copiate direttamente
+template <typename J>
+void appendKey(std::string &output, const typename J::string_t &key)
+{
+	if (std::ranges::all_of(key, [](const char c) { return c >= 0x20 && c < 0x7f && c != '"' && c != '\\'; }))
+	{
+		output.push_back('"');
+		output.append(key);
+		output.push_back('"');
+	}
+	else
+		output.append(J(key).dump(-1, ' ', true));
+}
+
+// dump (stesse opzioni di toString) di node indentato di currentIndent spazi. Nell'output di dump i '\n' sono solo
+// quelli dell'indentazione (nelle stringhe sono escapati), per cui basta aggiungere gli spazi dopo ogni '\n'
+template <typename J>
+void appendDump(std::string &output, const J &node, const int indent, const unsigned int currentIndent)
+{
+	const std::string text = node.dump(indent, ' ', true);
+	if (indent < 0 || currentIndent == 0 || !node.is_structured())
+	{
+		output.append(text);
+		return;
+	}
+	std::size_t begin = 0;
+	for (std::size_t newLine = text.find('\n'); newLine != std::string::npos; newLine = text.find('\n', begin))
+	{
+		output.append(text, begin, newLine + 1 - begin);
+		output.append(currentIndent, ' ');
+		begin = newLine + 1;
+	}
+	output.append(text, begin);
+}
+
+// Esegue work sul thread chiamante e su al massimo helpers task del JsonThreadPool condiviso e ritorna quando work
+// è terminato su tutti i thread che l'hanno iniziato. I task ancora in coda a quel punto non lo eseguono più, per
+// cui un toStringParallel chiamato da un task del pool non resta mai in attesa di task accodati dietro di lui
+void runOnSharedPool(const std::size_t helpers, const std::function<void()> &work)
+{
+	struct State
+	{
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::size_t running = 0;
+		bool closed = false;
+		std::exception_ptr exception;
+	};
+	auto state = std::make_shared<State>();
+
+	for (std::size_t helper = 0; helper < helpers; helper++)
+		JsonThreadPool::shared().post(
+			[state, &work]()
+			{
+				{
+					std::lock_guard<std::mutex> locker(state->mutex);
+					if (state->closed)
+						return;
+					state->running++;
+				}
+				std::exception_ptr exception;
+				try
+				{
+					work();
+				}
+				catch (...)
+				{
+					exception = std::current_exception();
+				}
+				{
+					std::lock_guard<std::mutex> locker(state->mutex);
+					if (exception)
+						state->exception = exception;
+					state->running--;
+				}
+				state->finished.notify_all();
+			}
+		);
+
+	std::exception_ptr exception;
+	try
+	{
+		work();
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	// l'eccezione (es. UTF-8 non valido) viene rilanciata solo dopo aver atteso i task che stanno usando work
+	std::unique_lock<std::mutex> locker(state->mutex);
+	state->closed = true;
+	state->finished.wait(locker, [&state]() { return state->running == 0; });
+	if (!exception)
+		exception = state->exception;
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+template <typename J>
+void serializeNode(
+	const J &node, const int indent, const unsigned int currentIndent, const std::size_t maxThreads, const std::size_t depth,
+	std::string &output
+)
+{
+	const bool parallel = maxThreads > 1 && node.size() >= toStringParallelMinElements;
+	if (maxThreads <= 1 || !node.is_structured() || node.empty() || (!parallel && depth >= toStringParallelMaxDepth))
+	{
+		appendDump(output, node, indent, currentIndent);
+		return;
+	}
+
+	const bool prettyPrint = indent >= 0;
+	const unsigned int childIndent = prettyPrint ? currentIndent + static_cast<unsigned int>(indent) : 0;
+
+	// separatore, indentazione, chiave e valore del figlio, come in dump
+	auto serializeChild = [&](const auto &it, const bool first, std::string &buffer, const bool sequential)
+	{
+		if (!first)
+			buffer.append(prettyPrint ? ",\n" : ",");
+		buffer.append(childIndent, ' ');
+		if (node.is_object())
+		{
+			appendKey<J>(buffer, it.key());
+			buffer.append(prettyPrint ? ": " : ":");
+		}
+		if (sequential || !it.value().is_structured())
+			appendDump(buffer, it.value(), indent, childIndent);
+		else
+			serializeNode(it.value(), indent, childIndent, maxThreads, depth + 1, buffer);
+	};
+
+	output.push_back(node.is_array() ? '[' : '{');
+	if (prettyPrint)
+		output.push_back('\n');
+
+	if (!parallel)
+	{
+		bool first = true;
+		for (auto it = node.begin(); it != node.end(); ++it, first = false)
+			serializeChild(it, first, output, false);
+	}
+	else
+	{
+		const std::size_t chunkElements = std::max(toStringParallelMinChunkElements, node.size() / (maxThreads * 8));
+		std::vector<typename J::const_iterator> chunkBegins;
+		std::size_t index = 0;
+		for (auto it = node.cbegin(); it != node.cend(); ++it, ++index)
+		{
+			if (index % chunkElements == 0)
+				chunkBegins.push_back(it);
+		}
+		chunkBegins.push_back(node.cend());
+
+		const std::size_t chunksNumber = chunkBegins.size() - 1;
+		std::vector<std::string> buffers(chunksNumber);
+		std::atomic<std::size_t> nextChunk{0};
+		runOnSharedPool(
+			std::min(maxThreads, chunksNumber) - 1,
+			[&]()
+			{
+				for (std::size_t chunk = nextChunk++; chunk < chunksNumber; chunk = nextChunk++)
+				{
+					bool first = chunk == 0;
+					for (auto it = chunkBegins[chunk]; it != chunkBegins[chunk + 1]; ++it, first = false)
+						serializeChild(it, first, buffers[chunk], true);
+				}
+			}
+		);
+
+		std::size_t bytes = output.size();
+		for (const std::string &buffer : buffers)
+			bytes += buffer.size();
+		output.reserve(bytes + currentIndent + 2);
+		for (const std::string &buffer : buffers)
+			output.append(buffer);
+	}
+
+	if (prettyPrint)
+	{
+		output.push_back('\n');
+		output.append(currentIndent, ' ');
+	}
+	output.push_back(node.is_array() ? ']' : '}');
+}
+} // namespace
+
+template <typename J>
+requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+std::string JSONUtils::toStringParallel(const J &root, const int indent, std::size_t maxThreads)
+{
+	try
+	{
+		if (maxThreads == 0)
+			maxThreads = std::max(1U, std::thread::hardware_concurrency());
+		std::string output;
+		serializeNode(root, indent, 0, maxThreads, 0, output);
+		return output;
+	}
+	catch (const nlohmann::json::type_error &e)
+	{
+		throw std::runtime_error(e.what());
+	}
+}
+
+template std::string JSONUtils::toStringParallel<nlohmann::json>(const nlohmann::json &, int, std::size_t);
+template std::string JSONUtils::toStringParallel<nlohmann::ordered_json>(const nlohmann::ordered_json &, int, std::size_t);
+
+void JSONUtils::parallelFor(const std::size_t chunksNumber, std::size_t maxThreads, const std::function<void(std::size_t)> &work)
+{
+	if (maxThreads == 0)
+		maxThreads = std::max(1U, std::thread::hardware_concurrency());
+	std::atomic<std::size_t> nextChunk{0};
+	runOnSharedPool(
+		std::min(maxThreads, chunksNumber) - 1,
+		[&]()
+		{
+			for (std::size_t chunk = nextChunk++; chunk < chunksNumber; chunk = nextChunk++)
+				work(chunk);
+		}
+	);
+}
+
+template <typename J>
+requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+J JSONUtils::loadConfigurationDirectory(const std::string_view &configurationDirectory, const std::string_view &glob,
+	const std::string_view &environmentPrefix, const ConfigurationFormat format)
+{
+	const std::vector<std::string> pathNames = configurationDirectoryFiles(configurationDirectory, glob);
+
+	std::vector<J> fragments(pathNames.size());
+	std::vector<std::string> errors(pathNames.size());
+	parallelFor(pathNames.size(), configurationDirectoryMaxThreads,
+		[&](const std::size_t index)
+		{
+			try
+			{
+				fragments[index] = loadConfigurationFile<J>(pathNames[index], environmentPrefix, format);
+			}
+			catch (const std::exception &e)
+			{
+				errors[index] = e.what();
+			}
+		}
+	);
+
+	std::vector<std::string> failures;
+	for (std::size_t index = 0; index < pathNames.size(); index++)
+	{
+		if (!errors[index].empty())
+			failures.push_back(std::format("{}: {}", pathNames[index], errors[index]));
+	}
+	if (!failures.empty())
+	{
+		const std::string errorMessage = fmt::format("loadConfigurationDirectory failed"
+			", configurationDirectory: {}"
+			", failed files: {}"
+			", errors: {}", configurationDirectory, failures.size(), fmt::join(failures, "; "));
+		LOG_ERROR(errorMessage);
+		throw std::runtime_error(errorMessage);
+	}
+
+	J root = J::object();
+	for (J &fragment : fragments)
+		deepMerge(root, std::move(fragment));
+	return root;
+}
+
+template nlohmann::json JSONUtils::loadConfigurationDirectory<nlohmann::json>(
+	const std::string_view &, const std::string_view &, const std::string_view &, ConfigurationFormat);
+template nlohmann::ordered_json JSONUtils::loadConfigurationDirectory<nlohmann::ordered_json>(
+	const std::string_view &, const std::string_view &, const std::string_view &, ConfigurationFormat);
+
+std::vector<std::string> JsonProjection::splitPath(const std::string_view path)
+{
+	std::vector<std::string> segments;
+	std::string segment;
+	for (const char c : path)
+	{
+		if (c == '.' || c == '[')
+		{
+			if (!segment.empty())
+				segments.push_back(std::move(segment));
+			segment.clear();
+			if (c == '[')
+				segment.push_back(c);
+		}
+		else
+		{
+			segment.push_back(c);
+			if (c == ']')
+			{
+				segments.push_back(std::move(segment));
+				segment.clear();
+			}
+		}
+	}
+	if (!segment.empty())
+		segments.push_back(std::move(segment));
+	return segments;
+}
+
+JsonProjection &JsonProjection::addRule(const std::string_view pathPattern, const Action action)
+{
+	// "servers[*].password" -> {"servers", "[*]", "password"}
+	Rule rule{splitPath(pathPattern), action};
+	_hasKeepRules = _hasKeepRules || action == Action::Keep;
+	_rules.push_back(std::move(rule));
+	return *this;
+}
+
+std::optional<JsonProjection::Action> JsonProjection::action(const std::span<const std::string> path) const
+{
+	for (const Rule &rule : _rules)
+	{
+		if (matches(rule.pattern, path, false))
+			return rule.action;
+	}
+	return std::nullopt;
+}
+
+bool JsonProjection::keepsDescendantOf(const std::span<const std::string> path) const
+{
+	return std::ranges::any_of(_rules, [&](const Rule &rule) { return rule.action == Action::Keep && matches(rule.pattern, path, true); });
+}
+
+// prefix: basta che path sia l'inizio di un path che corrisponde al pattern
+bool JsonProjection::matches(const std::span<const std::string> pattern, const std::span<const std::string> path, const bool prefix)
+{
+	if (pattern.empty())
+		return path.empty();
+	if (path.empty())
+		return prefix || std::ranges::all_of(pattern, [](const std::string &segment) { return segment == "**"; });
+	if (pattern.front() == "**")
+		return matches(pattern.subspan(1), path, prefix) || matches(pattern, path.subspan(1), prefix);
+	return wildcardMatch(path.front(), pattern.front()) && matches(pattern.subspan(1), path.subspan(1), prefix);
+}
+
+namespace
+{
+// Handler SAX di JSONUtils::project: scrive direttamente l'output, lo stato è solo uno Frame per livello di annidamento
+class ProjectionSax
+{
+public:
+	// basePath non vuoto: il testo è il valore che si trova in basePath di un documento più grande, le regole
+	// vengono applicate al path completo
+	ProjectionSax(const JsonProjection &projection, std::string &out, const std::span<const std::string> basePath = {})
+		: _projection(projection), _out(out)
+	{
+		if (basePath.empty())
+			return;
+
+		// decisione degli antenati del valore, come se fossero stati attraversati dal parsing
+		bool keep = !_projection.hasKeepRules();
+		for (std::size_t depth = 1; depth < basePath.size() && !_ancestorDecision; depth++)
+		{
+			const std::span<const std::string> ancestor = basePath.first(depth);
+			const std::optional<JsonProjection::Action> action = _projection.action(ancestor);
+			if (action == JsonProjection::Action::Keep)
+				keep = true;
+			else if (action == JsonProjection::Action::Drop)
+				_ancestorDecision = Decision::Drop;
+			else if (action == JsonProjection::Action::Mask)
+				_ancestorDecision = Decision::Mask;
+			else if (!keep && !_projection.keepsDescendantOf(ancestor))
+				_ancestorDecision = Decision::Drop;
+		}
+
+		// frame del contenitore (virtuale) del valore: non scrive né chiave né parentesi
+		_frames.push_back({false, keep});
+		_path.assign(basePath.begin(), basePath.end());
+		_baseDepth = 1;
+	}
+
+	bool null() { return scalar([this]() { _out.append("null"); }); }
+	bool boolean(const bool value) { return scalar([&]() { _out.append(value ? "true" : "false"); }); }
+	bool number_integer(const nlohmann::json::number_integer_t value) { return scalar([&]() { appendNumber(value); }); }
+	bool number_unsigned(const nlohmann::json::number_unsigned_t value) { return scalar([&]() { appendNumber(value); }); }
+	// il testo originale, per non cambiare la rappresentazione del numero
+	bool number_float(nlohmann::json::number_float_t, const nlohmann::json::string_t &text) { return scalar([&]() { _out.append(text); }); }
+	bool string(nlohmann::json::string_t &value) { return scalar([&]() { appendString(value); }); }
+	bool binary(nlohmann::json::binary_t &) { return true; }
+
+	bool start_object(std::size_t) { return startContainer(false); }
+	bool start_array(std::size_t) { return startContainer(true); }
+	bool end_object() { return endContainer('}'); }
+	bool end_array() { return endContainer(']'); }
+
+	bool key(nlohmann::json::string_t &key)
+	{
+		if (_skipDepth == 0)
+			_path.back() = key;
+		return true;
+	}
+
+	bool parse_error(const std::size_t position, const std::string &, const nlohmann::detail::exception &e)
+	{
+		// e.what() non viene riportato perché contiene l'ultimo token letto, cioè parte del testo da filtrare
+		_error = std::format("failed to project the json"
+			", at byte: {}"
+			", error id: {}", position, e.id);
+		return false;
+	}
+
+	[[nodiscard]] const std::optional<std::string> &error() const noexcept { return _error; }
+
+private:
+	struct Frame
+	{
+		bool array;
+		bool keep; // i figli non selezionati da una regola vengono mantenuti
+		bool first = true;
+		std::size_t index = 0;
+	};
+
+	enum class Decision
+	{
+		Emit,
+		EmitKeep,
+		Drop,
+		Mask
+	};
+
+	const JsonProjection &_projection;
+	std::string &_out;
+	std::vector<Frame> _frames;
+	std::vector<std::string> _path; // componente del figlio corrente di ogni frame
+	std::size_t _skipDepth = 0;		// > 0 dentro un contenitore eliminato o mascherato
+	std::optional<std::string> _error;
+	std::size_t _baseDepth = 0;		// 1 se il testo è il valore di un basePath
+	std::optional<Decision> _ancestorDecision;
+
+	Decision decide(const bool container)
+	{
+		if (_frames.empty())
+			return _projection.hasKeepRules() ? Decision::Emit : Decision::EmitKeep;
+
+		Frame &frame = _frames.back();
+		if (_frames.size() == _baseDepth && _ancestorDecision)
+			return *_ancestorDecision;
+		if (frame.array)
+			_path.back() = std::format("[{}]", frame.index++);
+
+		if (const std::optional<JsonProjection::Action> action = _projection.action(_path))
+		{
+			switch (*action)
+			{
+			case JsonProjection::Action::Keep:
+				return Decision::EmitKeep;
+			case JsonProjection::Action::Drop:
+				return Decision::Drop;
+			case JsonProjection::Action::Mask:
+				return Decision::Mask;
+			}
+		}
+		if (frame.keep)
+			return Decision::EmitKeep;
+		if (container && _projection.keepsDescendantOf(_path))
+			return Decision::Emit;
+		return Decision::Drop;
+	}
+
+	// separatore e, negli oggetti, la chiave
+	void appendPrefix()
+	{
+		if (_frames.size() <= _baseDepth)
+			return;
+		Frame &frame = _frames.back();
+		if (!frame.first)
+			_out.push_back(',');
+		frame.first = false;
+		if (!frame.array)
+		{
+			appendString(_path.back());
+			_out.push_back(':');
+		}
+	}
+
+	template <typename F>
+	bool scalar(F &&append)
+	{
+		if (_skipDepth > 0)
+			return true;
+		const Decision decision = decide(false);
+		if (decision == Decision::Drop)
+			return true;
+		appendPrefix();
+		if (decision == Decision::Mask)
+			appendString(_projection.maskValue());
+		else
+			append();
+		return true;
+	}
+
+	bool startContainer(const bool array)
+	{
+		if (_skipDepth > 0)
+		{
+			_skipDepth++;
+			return true;
+		}
+		const Decision decision = decide(true);
+		if (decision == Decision::Drop || decision == Decision::Mask)
+		{
+			if (decision == Decision::Mask)
+			{
+				appendPrefix();
+				appendString(_projection.maskValue());
+			}
+			_skipDepth = 1;
+			return true;
+		}
+		appendPrefix();
+		_out.push_back(array ? '[' : '{');
+		_frames.push_back({array, decision == Decision::EmitKeep});
+		_path.emplace_back();
+		return true;
+	}
+
+	bool endContainer(const char close)
+	{
+		if (_skipDepth > 0)
+		{
+			_skipDepth--;
+			return true;
+		}
+		_out.push_back(close);
+		_frames.pop_back();
+		_path.pop_back();
+		return true;
+	}
+
+	template <typename N>
+	void appendNumber(const N value)
+	{
+		char buffer[24];
+		auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		_out.append(buffer, ptr);
+	}
+
+	// stesso escape del serializer di nlohmann (senza ensure_ascii): il testo è già UTF-8 valido
+	void appendString(const std::string_view value)
+	{
+		_out.push_back('"');
+		for (const char c : value)
+		{
+			switch (c)
+			{
+			case '"':
+				_out.append("\\\"");
+				break;
+			case '\\':
+				_out.append("\\\\");
+				break;
+			case '\b':
+				_out.append("\\b");
+				break;
+			case '\f':
+				_out.append("\\f");
+				break;
+			case '\n':
+				_out.append("\\n");
+				break;
+			case '\r':
+				_out.append("\\r");
+				break;
+			case '\t':
+				_out.append("\\t");
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					std::format_to(std::back_inserter(_out), "\\u{:04x}", static_cast<unsigned int>(c));
+				else
+					_out.push_back(c);
+			}
+		}
+		_out.push_back('"');
+	}
+};
+
+std::atomic<std::shared_ptr<const JsonProjection>> logProjection;
+} // namespace
+
+std::optional<std::string> JSONUtils::projectText(const std::string_view in, const JsonProjection &projection, std::string &out,
+	const std::span<const std::string> basePath)
+{
+	ProjectionSax sax(projection, out, basePath);
+	nlohmann::json::sax_parse(in.begin(), in.end(), &sax);
+	return sax.error();
+}
+
+void JSONUtils::project(const std::string_view in, const JsonProjection &projection, std::string &out)
+{
+	if (std::optional<std::string> errorMessage = projectText(in, projection, out))
+	{
+		LOG_ERROR(*errorMessage);
+		throw std::runtime_error(*errorMessage);
+	}
+}
+
+void JSONUtils::setLogProjection(std::shared_ptr<const JsonProjection> projection) { logProjection.store(std::move(projection)); }
+
+bool JSONUtils::logProjectionActive() noexcept { return logProjection.load() != nullptr; }
+
+std::string JSONUtils::logExcerpt(const std::string_view json, const std::string_view path)
+{
+	const std::shared_ptr<const JsonProjection> projection = logProjection.load();
+	if (projection == nullptr)
+		return std::string(json);
+
+	const std::vector<std::string> basePath = JsonProjection::splitPath(path);
+	if (basePath.empty())
+	{
+		const std::size_t start = json.find_first_not_of(" \t\r\n");
+		if (start == std::string_view::npos || (json[start] != '{' && json[start] != '['))
+			return "<redacted>";
+	}
+
+	std::string out;
+	if (projectText(json, *projection, out, basePath))
+		return "<redacted json>";
+	if (out.empty()) // valore eliminato dalla projection
+		return "<redacted>";
+	return out;
+}
+
+std::string JSONUtils::logValue(const std::string_view json, const std::string_view path)
+{
+	std::string excerpt = logExcerpt(json, path);
+	if (excerpt.starts_with('"'))
+		return nlohmann::json::parse(excerpt).get<std::string>();
+	return excerpt;
+}
+
+void JSONUtils::handleParseError(const std::string_view json, const nlohmann::json::parse_error &e, const bool warningIfError)
+{
+	std::string errorMessage;
+	if (logProjectionActive())
+		// e.what() contiene l'ultimo token letto, cioè parte del testo da filtrare (come in project)
+		errorMessage = std::format("failed to parse the json"
+			", at byte: {}"
+			", error id: {}", e.byte, e.id);
+	else
+		errorMessage = std::format("failed to parse the json"
+			", json: '{}'"
+			", at byte: {}"
+			", exception: {}", json, e.byte, e.what());
+	if (warningIfError)
+		LOG_WARN(errorMessage);
+	else
+		LOG_ERROR(errorMessage);
+	throw std::runtime_error(errorMessage);
+}
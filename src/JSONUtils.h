@@ -12,12 +12,24 @@
 
 #pragma once
 
+#include "JsonEnum.h"
 #include "ThreadLogger.h"
 #include "nlohmann/json.hpp"
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <charconv>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <unordered_map>
 #include <spdlog/fmt/bundled/ranges.h>
 
 struct JsonFieldNotFound final : std::exception
@@ -29,6 +41,131 @@ struct JsonFieldNotFound final : std::exception
 	[[nodiscard]] char const *what() const noexcept override { return _errorMessage.c_str(); };
 };
 
+// Risultato di JSONUtils::extractColumns: una colonna std::vector<T> per ogni campo richiesto (struct-of-arrays)
+// e, per ogni colonna, una bitmap di validità (bit a 0 se il campo manca o non è convertibile in T)
+template <typename... T>
+struct JsonColumns
+{
+	std::size_t rows = 0;
+	std::tuple<std::vector<T>...> columns;
+	std::array<std::vector<std::uint64_t>, sizeof...(T)> validity;
+
+	template <std::size_t I>
+	[[nodiscard]] const auto &column() const { return std::get<I>(columns); }
+
+	[[nodiscard]] bool isValid(const std::size_t column, const std::size_t row) const
+	{
+		return (validity[column][row / 64] >> (row % 64)) & 1;
+	}
+};
+
+// Cache opzionale per JSONUtils::hash: memorizza l'hash dei sottoalberi (array/oggetti con almeno minContainerSize
+// elementi) di uno snapshot immutabile, così che hash e fastEquals ripetuti sullo snapshot o su sue parti non
+// ricalcolino i sottoalberi già visti. Lo snapshot è condiviso e const: finché la cache esiste i nodi non possono
+// cambiare né essere liberati, per cui un hash memorizzato non diventa mai obsoleto. Un documento modificato è un
+// nuovo snapshot e richiede una nuova cache. Non è thread safe
+template <typename J>
+requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+class JsonHashMemo
+{
+public:
+	explicit JsonHashMemo(std::shared_ptr<const J> snapshot, const std::size_t minContainerSize = 8)
+		: _snapshot(std::move(snapshot)), _minContainerSize(minContainerSize)
+	{
+		if (_snapshot == nullptr)
+			throw std::invalid_argument("JsonHashMemo: snapshot is null");
+	}
+
+	[[nodiscard]] const J &document() const noexcept { return *_snapshot; }
+	[[nodiscard]] const std::shared_ptr<const J> &snapshot() const noexcept { return _snapshot; }
+	[[nodiscard]] std::size_t size() const noexcept { return _hashes.size(); }
+
+private:
+	friend class JSONUtils;
+
+	std::shared_ptr<const J> _snapshot;
+	std::size_t _minContainerSize;
+	std::unordered_map<const J *, std::uint64_t> _hashes;
+};
+
+// Risultato di JSONUtils::memoryUsage. I byte di ogni nodo (sizeof(J) compreso) sono attribuiti al suo tipo;
+// chiavi e nodi dei map sono attribuiti agli oggetti, la capacità non usata ad array, oggetti e stringhe
+struct JsonMemoryUsage
+{
+	struct Subtree
+	{
+		std::string path; // stesso formato di JsonPath, es. "servers[2].tags"
+		std::size_t bytes;
+	};
+
+	std::size_t totalBytes = 0;
+	std::size_t nullBytes = 0;
+	std::size_t booleanBytes = 0;
+	std::size_t numberBytes = 0;
+	std::size_t stringBytes = 0;
+	std::size_t binaryBytes = 0;
+	std::size_t arrayBytes = 0;
+	std::size_t objectBytes = 0;
+
+	// array/oggetti più grandi (esclusa la radice), in ordine decrescente di byte
+	std::vector<Subtree> largestSubtrees;
+};
+
+// Regole di JSONUtils::project. I pattern sono path nel formato di JsonPath ("servers[0].password") in cui ogni
+// componente può contenere i wildcard '*' e '?' ("servers[*].pass*") e "**" indica un numero qualunque di
+// componenti ("**.password": il campo password a qualunque livello). Vale la prima regola che corrisponde.
+// Se c'è almeno una regola keep, le parti del documento non selezionate da un keep vengono eliminate
+//
+//	JsonProjection projection;
+//	projection.keep("user").keep("items[*].id").maskKey("pass*").dropKey("token");
+class JsonProjection
+{
+public:
+	enum class Action
+	{
+		Keep,
+		Drop,
+		Mask
+	};
+
+	JsonProjection &keep(std::string_view pathPattern) { return addRule(pathPattern, Action::Keep); }
+	JsonProjection &drop(std::string_view pathPattern) { return addRule(pathPattern, Action::Drop); }
+	JsonProjection &mask(std::string_view pathPattern) { return addRule(pathPattern, Action::Mask); }
+	// come drop/mask("**." + keyPattern): la chiave a qualunque livello
+	JsonProjection &dropKey(std::string_view keyPattern) { return addRule(std::format("**.{}", keyPattern), Action::Drop); }
+	JsonProjection &maskKey(std::string_view keyPattern) { return addRule(std::format("**.{}", keyPattern), Action::Mask); }
+	// stringa che sostituisce i valori mascherati (default "***")
+	JsonProjection &maskValue(std::string value)
+	{
+		_maskValue = std::move(value);
+		return *this;
+	}
+
+	// azione della prima regola che corrisponde a path (componenti già separate, es. {"servers", "[0]", "port"})
+	[[nodiscard]] std::optional<Action> action(std::span<const std::string> path) const;
+	// true se una regola keep può selezionare un discendente di path
+	[[nodiscard]] bool keepsDescendantOf(std::span<const std::string> path) const;
+	[[nodiscard]] bool hasKeepRules() const noexcept { return _hasKeepRules; }
+	[[nodiscard]] const std::string &maskValue() const noexcept { return _maskValue; }
+
+	// "servers[0].password" -> {"servers", "[0]", "password"} (stessa sintassi dei pattern)
+	[[nodiscard]] static std::vector<std::string> splitPath(std::string_view path);
+
+private:
+	struct Rule
+	{
+		std::vector<std::string> pattern;
+		Action action;
+	};
+
+	std::vector<Rule> _rules;
+	bool _hasKeepRules = false;
+	std::string _maskValue = "***";
+
+	JsonProjection &addRule(std::string_view pathPattern, Action action);
+	static bool matches(std::span<const std::string> pattern, std::span<const std::string> path, bool prefix);
+};
+
 class JSONUtils
 {
 public:
@@ -36,10 +173,15 @@ public:
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
 	static bool isPresent(const J &root, std::string_view field, const bool checksAlsoNotNull = false)
 	{
-		if (root == nullptr)
+		if (root.is_null())
 			return false;
 		if (checksAlsoNotNull)
-			return root.is_object() && root.contains(field) && !root.at(field).is_null();
+		{
+			if (!root.is_object())
+				return false;
+			auto it = root.find(field);
+			return it != root.end() && !it->is_null();
+		}
 		return root.is_object() && root.contains(field);
 
 		// Questa implementazione potrebbe sostituire l'implementazione sopra
@@ -51,7 +193,47 @@ public:
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
 	static bool isNull(const J &root, std::string_view field)
 	{
-		return isPresent(root, field) && root[field].is_null();
+		if (root.is_null() || !root.is_object())
+			return false;
+		auto it = root.find(field);
+		return it != root.end() && it->is_null();
+	}
+
+	// Risolve più campi dello stesso oggetto con una sola chiamata: ritorna per ogni campo il puntatore al valore
+	// oppure nullptr (anche se obj non è un oggetto). Per ordered_json, o se i campi sono almeno quante le chiavi,
+	// fa un'unica scansione dei membri invece di una ricerca per campo
+	//
+	//	auto [name, port, tags] = JSONUtils::lookupMany(root, {"name", "port", "tags"});
+	template <typename J, std::size_t N>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::array<const J *, N> lookupMany(const J &obj, std::span<const std::string_view, N> fields)
+	{
+		std::array<const J *, N> values;
+		findFields<J>(obj, fields, values);
+		return values;
+	}
+
+	template <typename J, std::size_t N>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::array<const J *, N> lookupMany(const J &obj, const std::string_view (&fields)[N])
+	{
+		return lookupMany<J, N>(obj, std::span<const std::string_view, N>(fields));
+	}
+
+	// Versione tipizzata: i valori vengono convertiti con le conversioni di getJsonValue.
+	// Campo mancante o null: std::nullopt; valore non convertibile: std::nullopt oppure, con exceptionOnError,
+	// std::invalid_argument
+	//
+	//	auto [name, port] = JSONUtils::lookupMany<std::string, int32_t>(root, {"name", "port"});
+	template <typename... T, typename J>
+	requires(sizeof...(T) > 0) && (std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>)
+	static std::tuple<std::optional<T>...> lookupMany(const J &obj, const std::array<std::string_view, sizeof...(T)> &fields,
+		const bool exceptionOnError = false)
+	{
+		std::array<const J *, sizeof...(T)> values;
+		findFields<J>(obj, fields, values);
+		return [&]<std::size_t... I>(std::index_sequence<I...>)
+		{ return std::tuple<std::optional<T>...>(lookupValue<T>(values[I], fields[I], exceptionOnError)...); }(std::index_sequence_for<T...>{});
 	}
 
 	template <typename J>
@@ -86,125 +268,25 @@ public:
 	static T as(const J& root, std::string_view field = {}, T defaultVal = {}, std::span<const T> allowedValues = {},
 		const bool exceptionOnError = false)
 	{
-		try
-		{
-			if (root == nullptr)
-			{
-				const std::string errorMessage = std::format("Received a json nullptr"
-					", field: {}", field);
-				if (exceptionOnError)
-				{
-					LOG_ERROR(errorMessage);
-					throw std::invalid_argument(errorMessage);
-				}
-				LOG_TRACE(errorMessage);
-				return defaultVal;
-			}
-			if (field.empty())
-			{
-				// T value = root.template get<T>();
-				T value = getJsonValue<T>(root);
-
-				if (!allowedValues.empty())
-				{
-					if (std::ranges::find(allowedValues, value) != allowedValues.end())
-						return value;
-
-					std::string errorMessage;
-					if constexpr (
-						std::is_same_v<T, nlohmann::json> ||
-						std::is_same_v<T, nlohmann::ordered_json>
-					)
-					{
-						std::vector<std::string> tmp;
-						tmp.reserve(allowedValues.size());
-						for (const auto& v : allowedValues)
-							tmp.push_back(JSONUtils::toString(v));
-						std::string allowedValuesStr = fmt::format("{}", fmt::join(tmp, ", "));
-						errorMessage = fmt::format(
-						"Invalid value '{}' for '{}'. Allowed values are: {}",
-							JSONUtils::toString(value), field, allowedValuesStr
-						);
-					}
-					else
-						errorMessage = fmt::format("Invalid value '{}' for '{}'. Allowed values are: {}",
-						value, field, fmt::join(allowedValues, ", ")
-						);
-					if (exceptionOnError)
-					{
-						LOG_ERROR(errorMessage);
-						throw std::invalid_argument(errorMessage);
-					}
-					LOG_TRACE(errorMessage);
-					return defaultVal;
-				}
-				return value;
-			}
-			if (!JSONUtils::isPresent(root, field))
-			{
-				const std::string errorMessage = std::format("Field [{}] not found", field);
-				if (exceptionOnError)
-				{
-					LOG_ERROR(errorMessage);
-					throw JsonFieldNotFound(errorMessage);
-				}
-				LOG_TRACE(errorMessage);
-				return defaultVal;
-			}
-			{
-				// T value = root.at(field).template get<T>();
-				T value = getJsonValue<T>(root.at(field));
-
-				if (!allowedValues.empty())
-				{
-					if (std::ranges::find(allowedValues, value) != allowedValues.end())
-						return value;
-
-					std::string errorMessage;
-					if constexpr (
-						std::is_same_v<T, nlohmann::json> ||
-						std::is_same_v<T, nlohmann::ordered_json>
-					)
-					{
-						std::vector<std::string> tmp;
-						tmp.reserve(allowedValues.size());
-						for (const auto& v : allowedValues)
-							tmp.push_back(JSONUtils::toString(v));
-						std::string allowedValuesStr = fmt::format("{}", fmt::join(tmp, ", "));
-						errorMessage = fmt::format(
-						"Invalid value '{}' for '{}'. Allowed values are: {}",
-							JSONUtils::toString(value), field, allowedValuesStr
-						);
-					}
-					else
-						errorMessage = fmt::format("Invalid value '{}' for '{}'. Allowed values are: {}",
-						value, field, fmt::join(allowedValues, ", ")
-						);
-					if (exceptionOnError)
-					{
-						LOG_ERROR(errorMessage);
-						throw std::invalid_argument(errorMessage);
-					}
-					LOG_TRACE(errorMessage);
-					return defaultVal;
-				}
-				return value;
-			}
-		}
-		catch (const std::exception& e)
+		if (root.is_null())
 		{
-			// abbiamo una eccezione se ad es. chiediamo una stringa (as<string>) ma il valore è un numero
-			const std::string errorMessage = field.empty() ?
-				std::format("json: {}, exception: {}", JSONUtils::toString(root), e.what()) :
-				std::format("json: {}, field: {}, exception: {}", JSONUtils::toString(root), field, e.what());
-			if (exceptionOnError)
-			{
-				LOG_ERROR(errorMessage);
-				throw;
-			}
-			LOG_TRACE(errorMessage);
+			handleError(std::format("Received a json nullptr"
+				", field: {}", field), exceptionOnError);
 			return defaultVal;
 		}
+		const J *fieldRoot = &root;
+		if (!field.empty())
+			fieldRoot = JSONUtils::isPresent(root, field) ? &root.at(field) : nullptr;
+		return asResolved<T>(fieldRoot, field, std::move(defaultVal), allowedValues, exceptionOnError, root);
+	}
+
+	// Come as(root, field, ...) quando il campo è già stato cercato dal chiamante (es. JsonRecord, PersistentJson):
+	// fieldRoot è il valore del campo oppure nullptr se il campo non è presente
+	template <typename T, typename J>
+	static T asField(const J *fieldRoot, std::string_view field, T defaultVal = {}, std::span<const T> allowedValues = {},
+		const bool exceptionOnError = false)
+	{
+		return asResolved<T>(fieldRoot, field, std::move(defaultVal), allowedValues, exceptionOnError, fieldRoot == nullptr ? missingFieldRoot<J>() : *fieldRoot);
 	}
 
 	template <typename T, typename J>
@@ -227,176 +309,185 @@ public:
 	static std::optional<T> asOpt(const J& root, std::string_view field = {}, std::span<const T> allowedValues = {},
 		const bool exceptionOnError = false)
 	{
-		try
+		if (root.is_null())
 		{
-			if (root == nullptr)
+			handleError("Received a json nullptr", exceptionOnError);
+			return std::nullopt;
+		}
+		const J *fieldRoot = &root;
+		if (!field.empty())
+			fieldRoot = JSONUtils::isPresent(root, field) ? &root.at(field) : nullptr;
+		return asOptResolved<T>(fieldRoot, field, allowedValues, exceptionOnError, root);
+	}
+
+	// Come asOpt(root, field, ...) con il campo già cercato dal chiamante (nullptr se non presente)
+	template <typename T, typename J>
+	static std::optional<T> asOptField(const J *fieldRoot, std::string_view field, std::span<const T> allowedValues = {},
+		const bool exceptionOnError = false)
+	{
+		return asOptResolved<T>(fieldRoot, field, allowedValues, exceptionOnError, fieldRoot == nullptr ? missingFieldRoot<J>() : *fieldRoot);
+	}
+
+	// Legge una stringa e la converte nell'enum E tramite la tabella JsonEnum<E>::table (vedi JsonEnum.h).
+	// I nomi della tabella sono anche gli unici valori ammessi: la verifica costa un hash e un confronto.
+	// L'elenco dei valori ammessi viene costruito solo se serve per l'eccezione
+	template <JsonMappedEnum E, typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static E asEnum(const J &root, std::string_view field, E defaultVal, const bool exceptionOnError = false)
+	{
+		const J *fieldRoot = &root;
+		if (!field.empty())
+		{
+			auto it = root.is_object() ? root.find(field) : root.end();
+			if (it == root.end())
 			{
-				const std::string errorMessage = "Received a json nullptr";
-				if (exceptionOnError)
-				{
-					LOG_ERROR(errorMessage);
-					throw std::invalid_argument(errorMessage);
-				}
-				LOG_TRACE(errorMessage);
-				return std::nullopt;
+				handleFieldNotFound(field, exceptionOnError);
+				return defaultVal;
 			}
-			if (field.empty())
-			{
-				// T value = root.template get<T>();
-				T value = getJsonValue<T>(root);
+			fieldRoot = &(*it);
+		}
 
-				if (!allowedValues.empty())
-				{
-					if (std::ranges::find(allowedValues, value) != allowedValues.end())
-						return value;
-
-					std::string errorMessage;
-					if constexpr (
-						std::is_same_v<T, nlohmann::json> ||
-						std::is_same_v<T, nlohmann::ordered_json>
-					)
-					{
-						std::vector<std::string> tmp;
-						tmp.reserve(allowedValues.size());
-						for (const auto& v : allowedValues)
-							tmp.push_back(JSONUtils::toString(v));
-						std::string allowedValuesStr = fmt::format("{}", fmt::join(tmp, ", "));
-						errorMessage = fmt::format(
-						"Invalid value '{}' for '{}'. Allowed values are: {}",
-							JSONUtils::toString(value), field, allowedValuesStr
-						);
-					}
-					else
-						errorMessage = fmt::format("Invalid value '{}' for '{}'. Allowed values are: {}",
-						value, field, fmt::join(allowedValues, ", ")
-						);
-					if (exceptionOnError)
-					{
-						LOG_ERROR(errorMessage);
-						throw std::invalid_argument(errorMessage);
-					}
-					LOG_TRACE(errorMessage);
-					return std::nullopt;
-				}
-				return value;
-			}
-			if (!JSONUtils::isPresent(root, field))
-				return std::nullopt;
-			{
-				// T value = root.at(field).template get<T>();
-				T value = getJsonValue<T>(root.at(field));
+		if (fieldRoot->is_string())
+		{
+			const auto &name = fieldRoot->template get_ref<const std::string &>();
+			if (const std::optional<E> value = JsonEnum<E>::table.find(name))
+				return *value;
+		}
 
-				if (!allowedValues.empty())
-				{
-					if (std::ranges::find(allowedValues, value) != allowedValues.end())
-						return value;
-
-					std::string errorMessage;
-					if constexpr (
-						std::is_same_v<T, nlohmann::json> ||
-						std::is_same_v<T, nlohmann::ordered_json>
-					)
-					{
-						std::vector<std::string> tmp;
-						tmp.reserve(allowedValues.size());
-						for (const auto& v : allowedValues)
-							tmp.push_back(JSONUtils::toString(v));
-						std::string allowedValuesStr = fmt::format("{}", fmt::join(tmp, ", "));
-						errorMessage = fmt::format(
-						"Invalid value '{}' for '{}'. Allowed values are: {}",
-							JSONUtils::toString(value), field, allowedValuesStr
-						);
-					}
-					else
-						errorMessage = fmt::format("Invalid value '{}' for '{}'. Allowed values are: {}",
-						value, field, fmt::join(allowedValues, ", ")
-						);
-					if (exceptionOnError)
-					{
-						LOG_ERROR(errorMessage);
-						throw std::invalid_argument(errorMessage);
-					}
-					LOG_TRACE(errorMessage);
-					return std::nullopt;
-				}
-				return value;
-			}
+		std::vector<std::string> allowedValues;
+		if (exceptionOnError)
+		{
+			allowedValues.reserve(JsonEnum<E>::table.values().size());
+			for (const auto &[name, value] : JsonEnum<E>::table.values())
+				allowedValues.emplace_back(name);
 		}
-		catch (const std::exception& e)
+		handleError(invalidValueMessage(logValue(*fieldRoot, field), field, allowedValues), exceptionOnError);
+		return defaultVal;
+	}
+
+	// Converte un array json in std::vector<T> applicando ad ogni elemento le conversioni di getJsonValue
+	// (a differenza di as<std::vector<T>> che usa la get generica di nlohmann).
+	// In caso di errore ritorna un vettore vuoto oppure, se exceptionOnError, lancia una eccezione
+	template <typename T, typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::vector<T> asVector(const J &root, std::string_view field = {}, const bool exceptionOnError = false)
+	{
+		const J *array = arrayField(root, field, exceptionOnError);
+		if (array == nullptr)
+			return {};
+
+		std::vector<T> values(array->size());
+		if (!arrayInto<T>(*array, values, field, exceptionOnError))
+			return {};
+		return values;
+	}
+
+	// Come asVector ma scrive gli elementi nel buffer del chiamante, senza allocazioni.
+	// Ritorna il numero di elementi scritti oppure std::nullopt in caso di errore (campo mancante, buffer
+	// troppo piccolo, elemento non convertibile)
+	template <typename T, typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::optional<std::size_t> asSpanInto(const J &root, std::string_view field, std::span<T> out,
+		const bool exceptionOnError = false)
+	{
+		const J *array = arrayField(root, field, exceptionOnError);
+		if (array == nullptr)
+			return std::nullopt;
+
+		if (array->size() > out.size())
 		{
-			// abbiamo una eccezione se ad es. chiediamo una stringa (as<string>) ma il valore è un numero
-			const std::string errorMessage = field.empty() ?
-				std::format("Json: {}, exception: {}", JSONUtils::toString(root), e.what()) :
-				std::format("Field: {}, exception: {}", field, e.what());
-			if (exceptionOnError)
-			{
-				LOG_ERROR(errorMessage);
-				throw;
-			}
-			LOG_TRACE(errorMessage);
+			handleError(std::format("Buffer too small for '{}'"
+				", elements: {}, buffer size: {}", field, array->size(), out.size()), exceptionOnError);
 			return std::nullopt;
 		}
+
+		if (!arrayInto<T>(*array, out.first(array->size()), field, exceptionOnError))
+			return std::nullopt;
+		return array->size();
 	}
 
+	// Stesse conversioni di getJsonValue ma senza log ed eccezioni: ritorna false se il valore non è convertibile in T.
+	// Utile nei loop su molti elementi dove il costo di try/catch e della formattazione del messaggio pesa
 	template <typename T, typename J>
-	static T getJsonValue(const J& fieldRoot)
+	static bool tryGetJsonValue(const J& fieldRoot, T& value)
 	{
 		if constexpr (std::is_same_v<T, std::string>)
 		{
 			if (fieldRoot.is_string())
-				return fieldRoot.template get<std::string>();
-			if (fieldRoot.is_number())
-				return fieldRoot.dump();   // converte 15.876 -> "15.876"
-			if (fieldRoot.is_boolean())
-				return fieldRoot.template get<bool>() ? "true" : "false";
-
-			const std::string errorMessage = std::format("getJsonValue failed"
-				", fieldRoot: {}", toString(fieldRoot)
-				);
-			LOG_ERROR(errorMessage);
-			throw std::invalid_argument(errorMessage);
+				value = fieldRoot.template get_ref<const std::string&>();
+			else if (fieldRoot.is_number())
+				value = fieldRoot.dump();   // converte 15.876 -> "15.876"
+			else if (fieldRoot.is_boolean())
+				value = fieldRoot.template get<bool>() ? "true" : "false";
+			else
+				return false;
+			return true;
 		}
 		else if constexpr (std::is_same_v<T, bool>)
 		{
 			if (fieldRoot.is_boolean())
-				return fieldRoot.template get<bool>();
+			{
+				value = fieldRoot.template get<bool>();
+				return true;
+			}
 			if (fieldRoot.is_number())
-				return fieldRoot.template get<double>() != 0.0;
+			{
+				value = fieldRoot.template get<double>() != 0.0;
+				return true;
+			}
 			if (fieldRoot.is_string())
 			{
 				const auto& s = fieldRoot.template get_ref<const std::string&>();
-				if (s == "true" || s == "1") return true;
-				if (s == "false" || s == "0") return false;
+				if (s == "true" || s == "1") { value = true; return true; }
+				if (s == "false" || s == "0") { value = false; return true; }
 			}
-
-			const std::string errorMessage = std::format("getJsonValue failed"
-				", fieldRoot: {}", toString(fieldRoot)
-				);
-			LOG_ERROR(errorMessage);
-			throw std::invalid_argument(errorMessage);
+			return false;
 		}
 		else if constexpr (std::is_arithmetic_v<T>) // NUMERIC TYPES REQUESTED
 		{
 			if (fieldRoot.is_number())
-				return fieldRoot.template get<T>();
+			{
+				value = fieldRoot.template get<T>();
+				return true;
+			}
 			if (fieldRoot.is_string())
 			{
 				const auto& s = fieldRoot.template get_ref<const std::string&>();
-				T value{};
 				auto [ptr, ec] = std::from_chars(
 					s.data(),
 					s.data() + s.size(),
 					value
 				);
-				if (ec == std::errc() && ptr == s.data() + s.size())
-					return value;
+				return ec == std::errc() && ptr == s.data() + s.size();
 			}
+			return false;
+		}
+		else
+		{
+			try
+			{
+				value = fieldRoot.template get<T>();
+				return true;
+			}
+			catch (const nlohmann::json::exception &)
+			{
+				return false;
+			}
+		}
+	}
 
-			const std::string errorMessage = std::format("getJsonValue failed"
-				", fieldRoot: {}", toString(fieldRoot)
-				);
-			LOG_ERROR(errorMessage);
-			throw std::invalid_argument(errorMessage);
+	template <typename T, typename J>
+	static T getJsonValue(const J& fieldRoot)
+	{
+		if constexpr (std::is_same_v<T, std::string> || std::is_arithmetic_v<T>)
+		{
+			T value{};
+			if (tryGetJsonValue(fieldRoot, value))
+				return value;
+
+			handleError(std::format("getJsonValue failed"
+				", fieldRoot: {}", logExcerpt(fieldRoot)), true); // lancia std::invalid_argument
+			return value;
 		}
 		else
 			return fieldRoot.template get<T>();
@@ -460,6 +551,50 @@ public:
 		return keys;
 	}
 
+	// Estrae i campi indicati da ogni oggetto di un array in colonne, es.:
+	//	auto cols = JSONUtils::extractColumns<double, int64_t>(root["orders"], {"price", "qty"});
+	// Le conversioni sono quelle di getJsonValue. Ogni oggetto viene risolto una sola volta per tutti i campi
+	// e gli array grandi vengono suddivisi tra il thread chiamante e il JsonThreadPool condiviso
+	template <typename... T, typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static JsonColumns<T...> extractColumns(const J &array, const std::array<std::string_view, sizeof...(T)> &fields)
+	{
+		JsonColumns<T...> result;
+		if (!array.is_array())
+			return result;
+
+		result.rows = array.size();
+		std::apply([&](auto &...column) { (column.resize(result.rows), ...); }, result.columns);
+		for (auto &bitmap : result.validity)
+			bitmap.assign((result.rows + 63) / 64, 0);
+
+		auto extractRows = [&](const std::size_t begin, const std::size_t end)
+		{
+			std::array<const J *, sizeof...(T)> resolved;
+			for (std::size_t row = begin; row < end; row++)
+			{
+				findFields<J>(array[row], fields, resolved);
+				[&]<std::size_t... I>(std::index_sequence<I...>)
+				{
+					(extractColumnValue<I>(resolved[I], result, row), ...);
+				}(std::index_sequence_for<T...>{});
+			}
+		};
+
+		// i chunk sono multipli di 64 righe in modo che due thread non scrivano mai nella stessa word
+		// delle bitmap (né di un eventuale std::vector<bool>)
+		const std::size_t chunk = (extractColumnsRowsPerThread + 63) / 64 * 64;
+		if (result.rows <= chunk)
+		{
+			extractRows(0, result.rows);
+			return result;
+		}
+		parallelFor((result.rows + chunk - 1) / chunk, 0,
+			[&](const std::size_t index) { extractRows(index * chunk, std::min((index + 1) * chunk, result.rows)); });
+
+		return result;
+	}
+
 	template <typename J>
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
 	static J toJson(const std::string_view &j, const bool warningIfError = false)
@@ -472,19 +607,7 @@ public:
 		}
 		catch (nlohmann::json::parse_error &ex)
 		{
-			std::string errorMessage = std::format(
-				"failed to parse the json"
-				", json: '{}'"
-				", at byte: {}"
-				", exception: {}",
-				j, ex.byte, ex.what()
-			);
-			if (warningIfError)
-				LOG_WARN(errorMessage);
-			else
-				LOG_ERROR(errorMessage);
-
-			throw std::runtime_error(errorMessage);
+			handleParseError(j, ex, warningIfError);
 		}
 	}
 
@@ -492,16 +615,35 @@ public:
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
 	static J toJson(const std::vector<T> &v)
 	{
-		J root = J::array();
-		for (const T& i : v)
-			root.push_back(i);
-		return root;
+		// vector<bool> non è una contiguous_range, per cui non passa dall'overload sotto
+		return rangeToJson<J>(v);
 	}
 
+	// std::span, std::array, array C, ... (le stringhe vanno invece all'overload che fa il parsing)
+	template <typename J, std::ranges::contiguous_range R>
+	requires (std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>) &&
+		std::ranges::sized_range<R> && (!std::is_convertible_v<const R &, std::string_view>)
+	static J toJson(const R &v)
+	{
+		return rangeToJson<J>(v);
+	}
+
+	enum class ConfigurationFormat
+	{
+		Json,  // json con commenti
+		Json5, // JSON5: anche virgole finali, chiavi non quotate, stringhe con apici singoli
+		Auto   // Json5 se il file ha estensione .json5, altrimenti Json
+	};
+
 	template <typename J>
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
-	static J loadConfigurationFile(const std::string_view &configurationPathName, const std::string_view &environmentPrefix = "")
+	static J loadConfigurationFile(const std::string_view &configurationPathName, const std::string_view &environmentPrefix = "",
+		ConfigurationFormat format = ConfigurationFormat::Json)
 	{
+		if (format == ConfigurationFormat::Auto)
+			format = configurationPathName.ends_with(".json5") ? ConfigurationFormat::Json5 : ConfigurationFormat::Json;
+		if (format == ConfigurationFormat::Json5)
+			return loadJson5ConfigurationFile<J>(configurationPathName, environmentPrefix);
 
 #ifdef BOOTSERVICE_DEBUG_LOG
 #ifdef _WIN32
@@ -547,6 +689,36 @@ public:
 		}
 	}
 
+	// Carica in parallelo (JsonThreadPool condiviso) i file di configurazione di una directory il cui nome soddisfa
+	// glob (es. "*.json", sono ammessi '*' e '?') e li unisce con deepMerge in ordine lessicografico di nome file,
+	// per cui a parità di chiave vince il file che viene dopo. Se uno o più file non sono validi l'eccezione li
+	// riporta tutti. Definita in JSONUtils.cpp
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static J loadConfigurationDirectory(const std::string_view &configurationDirectory, const std::string_view &glob = "*.json",
+		const std::string_view &environmentPrefix = "", ConfigurationFormat format = ConfigurationFormat::Auto);
+
+	// Unisce source in target: gli oggetti vengono uniti ricorsivamente, ogni altro valore (array compresi)
+	// di source sostituisce quello di target
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static void deepMerge(J &target, J source)
+	{
+		if (!target.is_object() || !source.is_object())
+		{
+			target = std::move(source);
+			return;
+		}
+		for (auto it = source.begin(); it != source.end(); ++it)
+		{
+			auto existing = target.find(it.key());
+			if (existing == target.end())
+				target[it.key()] = std::move(it.value());
+			else
+				deepMerge(*existing, std::move(it.value()));
+		}
+	}
+
 	template <typename J>
 	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
 	static std::string toString(const J &root, int indent = -1)
@@ -563,11 +735,791 @@ public:
 		}
 	}
 
+	// Come toString ma, per i documenti grandi, gli array e gli oggetti con molti figli (almeno 4096) vengono
+	// serializzati a blocchi in buffer separati, dal thread chiamante e dal JsonThreadPool condiviso (al massimo
+	// maxThreads thread in tutto, 0: hardware_concurrency), poi concatenati nell'ordine originale.
+	// L'output è identico byte per byte a toString con lo stesso indent. Definita in JSONUtils.cpp
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::string toStringParallel(const J &root, int indent = -1, std::size_t maxThreads = 0);
+
+	// Hash a 64 bit calcolato direttamente sul DOM, senza serializzare e senza allocazioni.
+	// È canonico: non dipende dall'ordine delle chiavi né dalla rappresentazione dei numeri (1 e 1.0 coincidono),
+	// per cui json e ordered_json con lo stesso contenuto hanno lo stesso hash
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::uint64_t hash(const J &root, const std::uint64_t seed = 0)
+	{
+		return hashNode<J>(root, seed);
+	}
+
+	// Come hash(root) sul nodo dello snapshot indicato da pointer (radice se vuoto), riusando e aggiornando
+	// la cache. Il nodo è cercato a partire dalla radice dello snapshot, per cui la cache vede solo nodi suoi
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::uint64_t hash(JsonHashMemo<J> &memo, const typename J::json_pointer &pointer = {})
+	{
+		return hashNode<J>(memo.document().at(pointer), 0, &memo);
+	}
+
+	// Hash XXH64 di un testo (stesso valore della libreria xxHash), es. per usarlo come chiave di cache
+	static std::uint64_t hashText(const std::string_view text, const std::uint64_t seed = 0) noexcept
+	{
+		return hashBytes(text.data(), text.size(), seed);
+	}
+
+	// Uguaglianza canonica (stessa semantica di hash): l'ordine delle chiavi non conta.
+	// Se gli hash differiscono ritorna false senza confrontare i due alberi
+	template <typename J1, typename J2>
+	requires (std::is_same_v<J1, nlohmann::json> || std::is_same_v<J1, nlohmann::ordered_json>) &&
+		(std::is_same_v<J2, nlohmann::json> || std::is_same_v<J2, nlohmann::ordered_json>)
+	static bool fastEquals(const J1 &a, const J2 &b)
+	{
+		if constexpr (std::is_same_v<J1, J2>)
+		{
+			if (&a == &b)
+				return true;
+		}
+		if (a.is_structured() != b.is_structured() || a.size() != b.size())
+			return false;
+		if (hashNode<J1>(a, 0) != hashNode<J2>(b, 0))
+			return false;
+		return canonicalEquals(a, b);
+	}
+
+	// fastEquals tra i documenti di due snapshot: gli hash vengono dalle rispettive cache
+	template <typename J1, typename J2>
+	requires (std::is_same_v<J1, nlohmann::json> || std::is_same_v<J1, nlohmann::ordered_json>) &&
+		(std::is_same_v<J2, nlohmann::json> || std::is_same_v<J2, nlohmann::ordered_json>)
+	static bool fastEquals(JsonHashMemo<J1> &a, JsonHashMemo<J2> &b)
+	{
+		const J1 &first = a.document();
+		const J2 &second = b.document();
+		if constexpr (std::is_same_v<J1, J2>)
+		{
+			if (&first == &second)
+				return true;
+		}
+		if (first.is_structured() != second.is_structured() || first.size() != second.size())
+			return false;
+		if (hashNode<J1>(first, 0, &a) != hashNode<J2>(second, 0, &b))
+			return false;
+		return canonicalEquals(first, second);
+	}
+
+	// Memoria occupata dal DOM, suddivisa per tipo di nodo. Con largestSubtreesNumber > 0 riporta anche i path
+	// degli array/oggetti più grandi, es. per capire quale parte di una configurazione o di una cache cresce.
+	// È una stima dal lato del contenitore: non considera l'overhead dell'allocatore
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static JsonMemoryUsage memoryUsage(const J &root, const std::size_t largestSubtreesNumber = 0)
+	{
+		JsonMemoryUsage usage;
+		std::string path;
+		std::vector<JsonMemoryUsage::Subtree> largestSubtrees;
+		typeBytes(usage, root.type()) += sizeof(J);
+		usage.totalBytes = sizeof(J) + memoryUsageNode(root, usage, path, largestSubtrees, largestSubtreesNumber);
+
+		std::ranges::sort_heap(largestSubtrees, std::ranges::greater{}, &JsonMemoryUsage::Subtree::bytes);
+		usage.largestSubtrees = std::move(largestSubtrees);
+		return usage;
+	}
+
+	// Elimina in un'unica visita la capacità non usata di array, stringhe, binary e (ordered_json) oggetti,
+	// es. dopo molti setOrAdd/push_back. Le chiavi degli oggetti sono const e non vengono toccate.
+	// Ritorna i byte liberati
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::size_t compact(J &root)
+	{
+		switch (root.type())
+		{
+		case J::value_t::string:
+		{
+			auto &value = root.template get_ref<typename J::string_t &>();
+			const std::size_t before = stringHeapBytes(value);
+			value.shrink_to_fit();
+			return before - stringHeapBytes(value);
+		}
+		case J::value_t::binary:
+		{
+			auto &value = root.get_binary();
+			const std::size_t before = value.capacity();
+			value.shrink_to_fit();
+			return before - value.capacity();
+		}
+		case J::value_t::array:
+		{
+			auto &array = root.template get_ref<typename J::array_t &>();
+			const std::size_t before = array.capacity();
+			array.shrink_to_fit();
+			std::size_t freedBytes = (before - array.capacity()) * sizeof(J);
+			for (J &element : array)
+				freedBytes += compact(element);
+			return freedBytes;
+		}
+		case J::value_t::object:
+		{
+			auto &object = root.template get_ref<typename J::object_t &>();
+			std::size_t freedBytes = 0;
+			if constexpr (std::is_same_v<J, nlohmann::ordered_json>)
+			{
+				const std::size_t before = object.capacity();
+				object.shrink_to_fit();
+				freedBytes = (before - object.capacity()) * sizeof(typename J::object_t::value_type);
+			}
+			for (auto &[key, value] : object)
+				freedBytes += compact(value);
+			return freedBytes;
+		}
+		default:
+			return 0;
+		}
+	}
+
+	// Riscrive il testo json in (aggiungendolo a out, in formato compatto) applicando projection, senza costruire il
+	// DOM: il parsing è SAX e la memoria usata dipende solo dalla profondità di annidamento. I numeri vengono
+	// riportati con il testo originale. Se in non è un json valido lancia std::runtime_error (senza riportarne il
+	// contenuto nel messaggio)
+	static void project(std::string_view in, const JsonProjection &projection, std::string &out);
+
+	// Se impostata, la projection viene applicata ai json che la libreria riporta nei log e nei messaggi delle
+	// eccezioni (as, asOpt, toJson, ...); i testi non validi vengono sostituiti da "<redacted json>".
+	// nullptr la disattiva
+	static void setLogProjection(std::shared_ptr<const JsonProjection> projection);
+
+	// json da riportare in un log/eccezione, filtrato dalla projection di setLogProjection come se si trovasse in
+	// path (es. "password" o "servers[0].password", vuoto: radice del documento). Con una projection impostata
+	// un valore scalare senza path viene omesso, perché nessuna regola può selezionarlo
+	static std::string logExcerpt(std::string_view json, std::string_view path = {});
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::string logExcerpt(const J &root, const std::string_view path = {})
+	{
+		return logExcerpt(toString(root), path);
+	}
+
 	static std::string json5ToJson(const std::string &json5);
 	static std::string applyEnvironmentToConfiguration(std::string configuration, const std::string_view &environmentPrefix);
 
   private:
+	// Percorsi di errore di as/asOpt/getJsonValue: sono definiti in JSONUtils.cpp in modo da non essere
+	// istanziati (e inlinati) in ogni translation unit insieme al percorso veloce
+
+	// exceptionOnError: LOG_ERROR + std::invalid_argument, altrimenti LOG_TRACE
+	static void handleError(const std::string &errorMessage, bool exceptionOnError);
+	// exceptionOnError: LOG_ERROR + JsonFieldNotFound, altrimenti LOG_TRACE
+	static void handleFieldNotFound(std::string_view field, bool exceptionOnError);
+	// da chiamare dentro un catch: exceptionOnError rilancia l'eccezione corrente, altrimenti LOG_TRACE
+	// (json vuoto se non va riportato nel messaggio)
+	static void handleException(const std::string &json, std::string_view field, const std::exception &e, bool exceptionOnError);
+	static std::string invalidValueMessage(std::string_view value, std::string_view field, const std::vector<std::string> &allowedValues);
+	template <typename J>
+	static const J &missingFieldRoot()
+	{
+		static const J empty;
+		return empty;
+	}
+
+	// parte comune di as/asField dopo la ricerca del campo; root serve solo per il messaggio di errore
+	template <typename T, typename J>
+	static T asResolved(const J *fieldRoot, std::string_view field, T defaultVal, std::span<const T> allowedValues,
+		const bool exceptionOnError, const J &root)
+	{
+		if (fieldRoot == nullptr)
+		{
+			handleFieldNotFound(field, exceptionOnError);
+			return defaultVal;
+		}
+		try
+		{
+			// T value = fieldRoot->template get<T>();
+			T value = getJsonValue<T>(*fieldRoot);
+			if (allowedValues.empty() || std::ranges::find(allowedValues, value) != allowedValues.end())
+				return value;
+
+			handleError(invalidValueMessage(value, field, allowedValues), exceptionOnError);
+			return defaultVal;
+		}
+		catch (const std::exception& e)
+		{
+			// abbiamo una eccezione se ad es. chiediamo una stringa (as<string>) ma il valore è un numero
+			handleException(logExcerpt(root), field, e, exceptionOnError);
+			return defaultVal;
+		}
+	}
+
+	template <typename T, typename J>
+	static std::optional<T> asOptResolved(const J *fieldRoot, std::string_view field, std::span<const T> allowedValues,
+		const bool exceptionOnError, const J &root)
+	{
+		if (fieldRoot == nullptr)
+			return std::nullopt;
+		try
+		{
+			// T value = fieldRoot->template get<T>();
+			T value = getJsonValue<T>(*fieldRoot);
+			if (allowedValues.empty() || std::ranges::find(allowedValues, value) != allowedValues.end())
+				return value;
+
+			handleError(invalidValueMessage(value, field, allowedValues), exceptionOnError);
+			return std::nullopt;
+		}
+		catch (const std::exception& e)
+		{
+			// abbiamo una eccezione se ad es. chiediamo una stringa (as<string>) ma il valore è un numero
+			handleException(field.empty() ? logExcerpt(root) : std::string(), field, e, exceptionOnError);
+			return std::nullopt;
+		}
+	}
+
+	static bool logProjectionActive() noexcept;
+	// come logExcerpt ma le stringhe senza virgolette, per i messaggi che riportano il valore tra apici
+	static std::string logValue(std::string_view json, std::string_view path);
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static std::string logValue(const J &value, const std::string_view path)
+	{
+		return logValue(toString(value), path);
+	}
+	// nullopt se ok, altrimenti il messaggio di errore. basePath: path del valore in nel documento
+	static std::optional<std::string> projectText(std::string_view in, const JsonProjection &projection, std::string &out,
+		std::span<const std::string> basePath = {});
+	// LOG_WARN/LOG_ERROR + std::runtime_error per un errore di parsing di toJson
+	[[noreturn]] static void handleParseError(std::string_view json, const nlohmann::json::parse_error &e, bool warningIfError);
+
+	template <typename T>
+	static std::string invalidValueMessage(const T &value, std::string_view field, std::span<const T> allowedValues)
+	{
+		// i valori ammessi vengono dal codice, non dal documento, e non vengono filtrati
+		auto valueToString = [](const T &v)
+		{
+			if constexpr (std::is_same_v<T, nlohmann::json> || std::is_same_v<T, nlohmann::ordered_json>)
+				return JSONUtils::toString(v);
+			else
+				return fmt::format("{}", v);
+		};
+		std::vector<std::string> allowedValuesStr;
+		allowedValuesStr.reserve(allowedValues.size());
+		for (const auto &v : allowedValues)
+			allowedValuesStr.push_back(valueToString(v));
+
+		std::string valueStr;
+		if constexpr (std::is_same_v<T, nlohmann::json> || std::is_same_v<T, nlohmann::ordered_json>)
+			valueStr = logExcerpt(value, field);
+		else if constexpr (std::is_constructible_v<nlohmann::json, const T &>)
+			valueStr = logProjectionActive() ? logValue(nlohmann::json(value), field) : valueToString(value);
+		else
+			valueStr = logProjectionActive() ? std::string("<redacted>") : valueToString(value);
+		return invalidValueMessage(valueStr, field, allowedValuesStr);
+	}
+
+	static constexpr std::size_t configurationDirectoryMaxThreads = 8;
+
+	static std::vector<std::string> configurationDirectoryFiles(const std::string_view &configurationDirectory, const std::string_view &glob);
+
+	// lettura, espansione delle ${VAR}, normalizzazione JSON5 e parsing fusi in un unico passaggio (vedi Json5Reader).
+	// Definita (e istanziata per json e ordered_json) in JSONUtils.cpp
+	template <typename J>
+	static J loadJson5ConfigurationFile(const std::string_view &configurationPathName, const std::string_view &environmentPrefix);
+
+	static constexpr std::uint64_t hashPrime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr std::uint64_t hashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr std::uint64_t hashPrime3 = 0x165667B19E3779F9ULL;
+	static constexpr std::uint64_t hashPrime4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr std::uint64_t hashPrime5 = 0x27D4EB2F165667C5ULL;
+
+	static constexpr std::uint64_t hashAvalanche(std::uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= hashPrime2;
+		h ^= h >> 29;
+		h *= hashPrime3;
+		h ^= h >> 32;
+		return h;
+	}
+
+	static constexpr std::uint64_t hashRound(const std::uint64_t accumulator, const std::uint64_t lane) noexcept
+	{
+		return std::rotl(accumulator + lane * hashPrime2, 31) * hashPrime1;
+	}
+
+	static constexpr std::uint64_t hashMergeRound(const std::uint64_t h, const std::uint64_t accumulator) noexcept
+	{
+		return (h ^ hashRound(0, accumulator)) * hashPrime1 + hashPrime4;
+	}
+
+	// XXH64
+	static std::uint64_t hashBytes(const char *data, std::size_t size, const std::uint64_t seed) noexcept
+	{
+		const std::uint64_t length = size;
+		std::uint64_t h;
+		if (size >= 32)
+		{
+			// 4 accumulatori indipendenti su blocchi da 32 byte
+			std::uint64_t v1 = seed + hashPrime1 + hashPrime2;
+			std::uint64_t v2 = seed + hashPrime2;
+			std::uint64_t v3 = seed;
+			std::uint64_t v4 = seed - hashPrime1;
+			for (; size >= 32; data += 32, size -= 32)
+			{
+				std::uint64_t lanes[4];
+				std::memcpy(lanes, data, 32);
+				v1 = hashRound(v1, lanes[0]);
+				v2 = hashRound(v2, lanes[1]);
+				v3 = hashRound(v3, lanes[2]);
+				v4 = hashRound(v4, lanes[3]);
+			}
+			h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+			h = hashMergeRound(h, v1);
+			h = hashMergeRound(h, v2);
+			h = hashMergeRound(h, v3);
+			h = hashMergeRound(h, v4);
+		}
+		else
+			h = seed + hashPrime5;
+		h += length;
+
+		for (; size >= 8; data += 8, size -= 8)
+		{
+			std::uint64_t lane;
+			std::memcpy(&lane, data, 8);
+			h ^= hashRound(0, lane);
+			h = std::rotl(h, 27) * hashPrime1 + hashPrime4;
+		}
+		if (size >= 4)
+		{
+			std::uint32_t lane;
+			std::memcpy(&lane, data, 4);
+			h ^= lane * hashPrime1;
+			h = std::rotl(h, 23) * hashPrime2 + hashPrime3;
+			data += 4;
+			size -= 4;
+		}
+		for (; size > 0; data++, size--)
+		{
+			h ^= static_cast<unsigned char>(*data) * hashPrime5;
+			h = std::rotl(h, 11) * hashPrime1;
+		}
+		return hashAvalanche(h);
+	}
+
+	template <typename J>
+	static std::uint64_t hashNode(const J &node, const std::uint64_t seed, JsonHashMemo<J> *memo = nullptr)
+	{
+		// i numeri interi (anche se float o unsigned) hanno tutti la stessa rappresentazione
+		auto hashInteger = [seed](const std::int64_t value) { return hashAvalanche(seed ^ hashPrime3 ^ (value * hashPrime1)); };
+
+		switch (node.type())
+		{
+		case J::value_t::null:
+		case J::value_t::discarded:
+			return hashAvalanche(seed ^ hashPrime4);
+		case J::value_t::boolean:
+			return hashAvalanche(seed ^ hashPrime2 ^ (node.template get<bool>() ? 1 : 2));
+		case J::value_t::number_integer:
+			return hashInteger(node.template get<std::int64_t>());
+		case J::value_t::number_unsigned:
+		{
+			const auto value = node.template get<std::uint64_t>();
+			if (value <= static_cast<std::uint64_t>(INT64_MAX))
+				return hashInteger(static_cast<std::int64_t>(value));
+			return hashAvalanche(seed ^ hashPrime5 ^ value);
+		}
+		case J::value_t::number_float:
+		{
+			const double value = node.template get<double>();
+			if (value >= -9223372036854775808.0 && value < 9223372036854775808.0 && static_cast<double>(static_cast<std::int64_t>(value)) == value)
+				return hashInteger(static_cast<std::int64_t>(value));
+			if (value >= 9223372036854775808.0 && value < 18446744073709551616.0 && static_cast<double>(static_cast<std::uint64_t>(value)) == value)
+				return hashAvalanche(seed ^ hashPrime5 ^ static_cast<std::uint64_t>(value));
+			return hashAvalanche(seed ^ hashPrime1 ^ std::bit_cast<std::uint64_t>(value));
+		}
+		case J::value_t::string:
+		{
+			const auto &value = node.template get_ref<const std::string &>();
+			return hashBytes(value.data(), value.size(), seed ^ hashPrime2);
+		}
+		case J::value_t::binary:
+		{
+			const auto &value = node.get_binary();
+			return hashBytes(reinterpret_cast<const char *>(value.data()), value.size(), seed ^ hashPrime3);
+		}
+		default:
+			break;
+		}
+
+		const bool memoized = memo != nullptr && node.size() >= memo->_minContainerSize;
+		if (memoized)
+		{
+			if (auto it = memo->_hashes.find(&node); it != memo->_hashes.end())
+				return it->second;
+		}
+
+		std::uint64_t h;
+		if (node.is_array())
+		{
+			h = seed ^ hashPrime1 ^ node.size();
+			for (const J &element : node)
+				h = std::rotl(h ^ hashNode<J>(element, seed, memo), 27) * hashPrime1 + hashPrime4;
+		}
+		else
+		{
+			// combinazione commutativa delle coppie chiave/valore: l'hash non dipende dall'ordine delle chiavi
+			std::uint64_t sum = 0;
+			std::uint64_t xored = 0;
+			for (auto it = node.begin(); it != node.end(); ++it)
+			{
+				const std::string &key = it.key();
+				const std::uint64_t member = hashAvalanche(
+					hashBytes(key.data(), key.size(), seed ^ hashPrime4) ^ std::rotl(hashNode<J>(it.value(), seed, memo), 17) * hashPrime5
+				);
+				sum += member;
+				xored ^= member;
+			}
+			h = seed ^ hashPrime2 ^ node.size() ^ sum ^ std::rotl(xored, 31);
+		}
+		h = hashAvalanche(h);
+
+		if (memoized)
+			memo->_hashes.emplace(&node, h);
+		return h;
+	}
+
+	// byte allocati fuori dall'oggetto std::string (0 se la stringa è nel buffer SSO)
+	static std::size_t stringHeapBytes(const std::string &value) noexcept
+	{
+		static const std::size_t ssoCapacity = std::string().capacity();
+		return value.capacity() > ssoCapacity ? value.capacity() + 1 : 0;
+	}
+
+	static std::size_t &typeBytes(JsonMemoryUsage &usage, const nlohmann::json::value_t type) noexcept
+	{
+		switch (type)
+		{
+		case nlohmann::json::value_t::boolean:
+			return usage.booleanBytes;
+		case nlohmann::json::value_t::number_integer:
+		case nlohmann::json::value_t::number_unsigned:
+		case nlohmann::json::value_t::number_float:
+			return usage.numberBytes;
+		case nlohmann::json::value_t::string:
+			return usage.stringBytes;
+		case nlohmann::json::value_t::binary:
+			return usage.binaryBytes;
+		case nlohmann::json::value_t::array:
+			return usage.arrayBytes;
+		case nlohmann::json::value_t::object:
+			return usage.objectBytes;
+		default:
+			return usage.nullBytes;
+		}
+	}
+
+	// ritorna i byte del sottoalbero escluso sizeof(J) del nodo, che è conteggiato dal contenitore
+	template <typename J>
+	static std::size_t memoryUsageNode(
+		const J &node, JsonMemoryUsage &usage, std::string &path, std::vector<JsonMemoryUsage::Subtree> &largestSubtrees,
+		const std::size_t largestSubtreesNumber
+	)
+	{
+		std::size_t ownBytes;
+		std::size_t childrenBytes = 0;
+		const std::size_t pathLength = path.size();
+
+		switch (node.type())
+		{
+		case J::value_t::string:
+			ownBytes = sizeof(typename J::string_t) + stringHeapBytes(node.template get_ref<const typename J::string_t &>());
+			usage.stringBytes += ownBytes;
+			return ownBytes;
+		case J::value_t::binary:
+			ownBytes = sizeof(typename J::binary_t) + node.get_binary().capacity();
+			usage.binaryBytes += ownBytes;
+			return ownBytes;
+		case J::value_t::array:
+		{
+			const auto &array = node.template get_ref<const typename J::array_t &>();
+			ownBytes = sizeof(typename J::array_t) + (array.capacity() - array.size()) * sizeof(J);
+			usage.arrayBytes += ownBytes;
+			std::size_t index = 0;
+			for (const J &element : array)
+			{
+				typeBytes(usage, element.type()) += sizeof(J);
+				std::format_to(std::back_inserter(path), "[{}]", index++);
+				childrenBytes += sizeof(J) + memoryUsageNode(element, usage, path, largestSubtrees, largestSubtreesNumber);
+				path.resize(pathLength);
+			}
+			break;
+		}
+		case J::value_t::object:
+		{
+			using Member = typename J::object_t::value_type;
+			const auto &object = node.template get_ref<const typename J::object_t &>();
+			ownBytes = sizeof(typename J::object_t);
+			if constexpr (std::is_same_v<J, nlohmann::ordered_json>)
+				ownBytes += object.capacity() * (sizeof(Member) - sizeof(J)) + (object.capacity() - object.size()) * sizeof(J);
+			else
+				ownBytes += object.size() * (mapNodeOverhead + sizeof(Member) - sizeof(J));
+			for (const auto &[key, value] : object)
+			{
+				ownBytes += stringHeapBytes(key);
+				typeBytes(usage, value.type()) += sizeof(J);
+				if (pathLength > 0)
+					path.push_back('.');
+				path.append(key);
+				childrenBytes += sizeof(J) + memoryUsageNode(value, usage, path, largestSubtrees, largestSubtreesNumber);
+				path.resize(pathLength);
+			}
+			usage.objectBytes += ownBytes;
+			break;
+		}
+		default:
+			return 0;
+		}
+
+		// min-heap dei sottoalberi più grandi
+		const std::size_t subtreeBytes = ownBytes + childrenBytes;
+		if (largestSubtreesNumber > 0 && pathLength > 0 &&
+			(largestSubtrees.size() < largestSubtreesNumber || subtreeBytes > largestSubtrees.front().bytes))
+		{
+			largestSubtrees.push_back({path, subtreeBytes + sizeof(J)});
+			std::ranges::push_heap(largestSubtrees, std::ranges::greater{}, &JsonMemoryUsage::Subtree::bytes);
+			if (largestSubtrees.size() > largestSubtreesNumber)
+			{
+				std::ranges::pop_heap(largestSubtrees, std::ranges::greater{}, &JsonMemoryUsage::Subtree::bytes);
+				largestSubtrees.pop_back();
+			}
+		}
+		return subtreeBytes;
+	}
+
+	// header di un nodo red-black di std::map (colore + 3 puntatori)
+	static constexpr std::size_t mapNodeOverhead = 4 * sizeof(void *);
+
+	template <typename J1, typename J2>
+	static bool canonicalEquals(const J1 &a, const J2 &b)
+	{
+		if (a.is_object())
+		{
+			if (!b.is_object() || a.size() != b.size())
+				return false;
+			for (auto it = a.begin(); it != a.end(); ++it)
+			{
+				auto other = b.find(it.key());
+				if (other == b.end() || !canonicalEquals(it.value(), *other))
+					return false;
+			}
+			return true;
+		}
+		if (a.is_array())
+		{
+			if (!b.is_array() || a.size() != b.size())
+				return false;
+			for (std::size_t index = 0; index < a.size(); index++)
+			{
+				if (!canonicalEquals(a[index], b[index]))
+					return false;
+			}
+			return true;
+		}
+		if (a.is_number() && b.is_number())
+		{
+			if (a.is_number_float() || b.is_number_float())
+				return a.template get<double>() == b.template get<double>();
+			// interi: signed e unsigned coincidono se il valore è lo stesso
+			const bool aNegative = !a.is_number_unsigned() && a.template get<std::int64_t>() < 0;
+			const bool bNegative = !b.is_number_unsigned() && b.template get<std::int64_t>() < 0;
+			if (aNegative || bNegative)
+				return aNegative && bNegative && a.template get<std::int64_t>() == b.template get<std::int64_t>();
+			return a.template get<std::uint64_t>() == b.template get<std::uint64_t>();
+		}
+		if (a.type() != b.type())
+			return false;
+		if (a.is_string())
+			return a.template get_ref<const std::string &>() == b.template get_ref<const std::string &>();
+		if (a.is_boolean())
+			return a.template get<bool>() == b.template get<bool>();
+		if (a.is_binary())
+			return a.get_binary() == b.get_binary();
+		return true; // null
+	}
+
+	static constexpr std::size_t extractColumnsRowsPerThread = 16384;
+
+	// esegue work(chunk) per ogni chunk in [0, chunksNumber) dal thread chiamante e da al massimo maxThreads - 1
+	// task del JsonThreadPool condiviso (0: hardware_concurrency); ritorna dopo l'ultimo chunk e ne rilancia
+	// l'eventuale eccezione
+	static void parallelFor(std::size_t chunksNumber, std::size_t maxThreads, const std::function<void(std::size_t)> &work);
+
+	// Risolve più campi dello stesso oggetto: out[i] punta al valore di fields[i] oppure è nullptr.
+	// Per ordered_json (e per oggetti piccoli) una sola scansione dei membri costa meno di una find per campo
+	template <typename J>
+	static void findFields(const J &obj, std::span<const std::string_view> fields, std::span<const J *> out)
+	{
+		std::ranges::fill(out, nullptr);
+		if (!obj.is_object())
+			return;
+
+		if (std::is_same_v<J, nlohmann::ordered_json> || obj.size() <= fields.size())
+		{
+			std::size_t remaining = fields.size();
+			for (auto it = obj.begin(); it != obj.end() && remaining > 0; ++it)
+			{
+				const std::string &key = it.key();
+				for (std::size_t index = 0; index < fields.size(); index++)
+				{
+					if (out[index] == nullptr && fields[index] == key)
+					{
+						out[index] = &it.value();
+						remaining--;
+					}
+				}
+			}
+		}
+		else
+		{
+			for (std::size_t index = 0; index < fields.size(); index++)
+			{
+				auto it = obj.find(fields[index]);
+				if (it != obj.end())
+					out[index] = &(*it);
+			}
+		}
+	}
+
+	template <typename T, typename J>
+	static std::optional<T> lookupValue(const J *value, const std::string_view field, const bool exceptionOnError)
+	{
+		if (value == nullptr || value->is_null())
+			return std::nullopt;
+		T converted{};
+		if (tryGetJsonValue(*value, converted))
+			return converted;
+		handleError(std::format("lookupMany failed"
+			", field: {}"
+			", value: {}", field, logExcerpt(*value, field)), exceptionOnError);
+		return std::nullopt;
+	}
+
+	template <typename J, typename R>
+	static J rangeToJson(const R &v)
+	{
+		typename J::array_t values;
+		values.reserve(std::ranges::size(v));
+		for (const auto &i : v)
+			values.emplace_back(i);
+		return J(std::move(values));
+	}
+
+	// ritorna l'array indicato da root/field oppure nullptr (gestendo l'errore come as)
+	template <typename J>
+	static const J *arrayField(const J &root, std::string_view field, const bool exceptionOnError)
+	{
+		const J *array = &root;
+		if (!field.empty())
+		{
+			auto it = root.is_object() ? root.find(field) : root.end();
+			if (it == root.end())
+			{
+				handleFieldNotFound(field, exceptionOnError);
+				return nullptr;
+			}
+			array = &(*it);
+		}
+		if (!array->is_array())
+		{
+			handleError(std::format("Field [{}] is not an array", field), exceptionOnError);
+			return nullptr;
+		}
+		return array;
+	}
+
+	// out deve avere almeno array.size() elementi
+	template <typename T, typename J, typename Out>
+	static bool arrayInto(const J &array, Out &&out, std::string_view field, const bool exceptionOnError)
+	{
+		const auto &values = array.template get_ref<const typename J::array_t &>();
+		for (std::size_t index = 0; index < values.size(); index++)
+		{
+			const J &value = values[index];
+			if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+			{
+				// fast path per gli array di soli numeri: nessun dispatch sulle conversioni da stringa
+				switch (value.type())
+				{
+				case J::value_t::number_float:
+					out[index] = static_cast<T>(value.template get_ref<const typename J::number_float_t &>());
+					continue;
+				case J::value_t::number_integer:
+					out[index] = static_cast<T>(value.template get_ref<const typename J::number_integer_t &>());
+					continue;
+				case J::value_t::number_unsigned:
+					out[index] = static_cast<T>(value.template get_ref<const typename J::number_unsigned_t &>());
+					continue;
+				default:
+					break;
+				}
+			}
+			T converted{};
+			if (!tryGetJsonValue(value, converted))
+			{
+				handleError(std::format("Invalid element for '{}'"
+					", index: {}, element: {}", field, index, logExcerpt(value, std::format("{}[{}]", field, index))), exceptionOnError);
+				return false;
+			}
+			out[index] = std::move(converted);
+		}
+		return true;
+	}
+
+	template <std::size_t I, typename J, typename... T>
+	static void extractColumnValue(const J *fieldRoot, JsonColumns<T...> &result, const std::size_t row)
+	{
+		using C = std::tuple_element_t<I, std::tuple<T...>>;
+		C value{};
+		if (fieldRoot == nullptr || !tryGetJsonValue(*fieldRoot, value))
+			return;
+		std::get<I>(result.columns)[row] = std::move(value);
+		result.validity[I][row / 64] |= std::uint64_t{1} << (row % 64);
+	}
+
 	static std::string json5_removeComments(const std::string &input);
 	static std::string json5_removeTrailingCommas(const std::string &input);
 	static std::string json5_quoteUnquotedKeys(const std::string &input);
 };
+
+// Istanziazioni esplicite (definite in JSONUtils.cpp, quindi nella libreria) per json/ordered_json e i tipi
+// più usati: le translation unit che includono questo header non ne emettono una propria copia.
+// Gli accessor sono definiti nella classe, quindi inline: la dichiarazione extern non impedisce al compilatore
+// di metterli inline nel chiamante
+#define JSONUTILS_INSTANTIATE_AS(EXTERN, J, T) \
+	EXTERN template T JSONUtils::as<T, J>(const J &, std::string_view, T, std::span<const T>, bool); \
+	EXTERN template std::optional<T> JSONUtils::asOpt<T, J>(const J &, std::string_view, std::span<const T>, bool); \
+	EXTERN template T JSONUtils::getJsonValue<T, J>(const J &); \
+	EXTERN template bool JSONUtils::tryGetJsonValue<T, J>(const J &, T &);
+
+#define JSONUTILS_INSTANTIATE(EXTERN, J) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, std::string) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, bool) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, int32_t) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, int64_t) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, uint32_t) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, uint64_t) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, double) \
+	JSONUTILS_INSTANTIATE_AS(EXTERN, J, J) \
+	EXTERN template bool JSONUtils::isPresent<J>(const J &, std::string_view, bool); \
+	EXTERN template bool JSONUtils::isNull<J>(const J &, std::string_view); \
+	EXTERN template std::vector<std::string> JSONUtils::keys<J>(const J &); \
+	EXTERN template J JSONUtils::toJson<J>(const std::string_view &, bool); \
+	EXTERN template std::string JSONUtils::toString<J>(const J &, int); \
+	EXTERN template J JSONUtils::loadConfigurationFile<J>(const std::string_view &, const std::string_view &, JSONUtils::ConfigurationFormat);
+
+JSONUTILS_INSTANTIATE(extern, nlohmann::json)
+JSONUTILS_INSTANTIATE(extern, nlohmann::ordered_json)
+
+// JSONUtils.cpp definisce JSONUTILS_INSTANTIATION prima dell'include per riusare la macro
+#ifndef JSONUTILS_INSTANTIATION
+#undef JSONUTILS_INSTANTIATE_AS
+#undef JSONUTILS_INSTANTIATE
+#endif
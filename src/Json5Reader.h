@@ -0,0 +1,435 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "nlohmann/json.hpp"
+
+// Tokenizer JSON5 in un unico passaggio usato da JSONUtils::loadConfigurationFile: legge i byte dallo stream,
+// espande le ${VAR} (solo le variabili che iniziano con environmentPrefix, come applyEnvironmentToConfiguration),
+// salta i commenti, accetta virgole finali, chiavi non quotate e stringhe con apici singoli e invia gli eventi
+// direttamente ad un handler SAX con l'interfaccia di nlohmann::json_sax, senza costruire testo intermedio.
+// Gli errori riportano riga e colonna nel file originale.
+class Json5Reader
+{
+public:
+	Json5Reader(std::streambuf &input, const std::string_view environmentPrefix, const std::string_view sourceName)
+		: _input(input), _environmentPrefix(environmentPrefix), _sourceName(sourceName)
+	{}
+
+	template <typename Sax>
+	void parse(Sax &sax)
+	{
+		skipWhitespacesAndComments();
+		parseValue(sax, 0);
+		skipWhitespacesAndComments();
+		if (peek() != eof)
+			error("unexpected content after the json value");
+	}
+
+private:
+	static constexpr int eof = std::char_traits<char>::eof();
+	static constexpr std::size_t maxDepth = 512;
+
+	std::streambuf &_input;
+	std::string_view _environmentPrefix;
+	std::string_view _sourceName;
+
+	// testo da restituire prima di riprendere la lettura dal file (valore di una ${VAR} o testo non espanso)
+	std::string _pending;
+	std::size_t _pendingPosition = 0;
+
+	// posizione (nel file originale) del prossimo carattere da leggere
+	std::size_t _line = 1;
+	std::size_t _column = 1;
+
+	std::string _token; // buffer riutilizzato per stringhe, chiavi e numeri
+
+	[[noreturn]] void error(const std::string_view message) const
+	{
+		throw std::runtime_error(std::format("failed to parse the json"
+			", configurationPathName: {}"
+			", line: {}"
+			", column: {}"
+			", error: {}", _sourceName, _line, _column, message));
+	}
+
+	int bumpRaw()
+	{
+		const int c = _input.sbumpc();
+		if (c == '\n')
+		{
+			_line++;
+			_column = 1;
+		}
+		else if (c != eof)
+			_column++;
+		return c;
+	}
+
+	int peek()
+	{
+		if (_pendingPosition < _pending.size())
+			return static_cast<unsigned char>(_pending[_pendingPosition]);
+
+		const int c = _input.sgetc();
+		if (c != '$' || _environmentPrefix.empty())
+			return c;
+
+		// ${VAR}: se è una variabile con il prefisso ed è definita viene sostituita dal suo valore,
+		// altrimenti il testo viene restituito così com'è
+		bumpRaw();
+		_pending = "$";
+		_pendingPosition = 0;
+		if (_input.sgetc() == '{')
+		{
+			_pending.push_back(static_cast<char>(bumpRaw()));
+			std::string name;
+			int n;
+			while ((n = _input.sgetc()) != eof && (std::isalnum(n) || n == '_'))
+				name.push_back(static_cast<char>(bumpRaw()));
+			if (n == '}')
+			{
+				bumpRaw();
+				const char *value = name.starts_with(_environmentPrefix) ? std::getenv(name.c_str()) : nullptr;
+				if (value != nullptr)
+					_pending = value;
+				else
+				{
+					_pending += name;
+					_pending.push_back('}');
+				}
+			}
+			else
+				_pending += name;
+		}
+		return _pending.empty() ? peek() : static_cast<unsigned char>(_pending[0]);
+	}
+
+	int get()
+	{
+		const int c = peek();
+		if (_pendingPosition < _pending.size())
+		{
+			if (++_pendingPosition == _pending.size())
+			{
+				_pending.clear();
+				_pendingPosition = 0;
+			}
+			return c;
+		}
+		return bumpRaw();
+	}
+
+	void expect(const char expected)
+	{
+		if (get() != expected)
+			error(std::format("expected '{}'", expected));
+	}
+
+	void skipWhitespacesAndComments()
+	{
+		for (;;)
+		{
+			const int c = peek();
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+				get();
+			else if (c == '/')
+			{
+				get();
+				const int next = get();
+				if (next == '/')
+				{
+					int e;
+					while ((e = peek()) != eof && e != '\n')
+						get();
+				}
+				else if (next == '*')
+				{
+					int previous = 0;
+					int e;
+					while ((e = get()) != eof && !(previous == '*' && e == '/'))
+						previous = e;
+					if (e == eof)
+						error("unterminated comment");
+				}
+				else
+					error("unexpected '/'");
+			}
+			else if (c == 0xEF && _line == 1 && _column == 1) // BOM UTF-8
+			{
+				get();
+				if (get() != 0xBB || get() != 0xBF)
+					error("invalid UTF-8 BOM");
+			}
+			else
+				return;
+		}
+	}
+
+	static bool isIdentifierStart(const int c) { return std::isalpha(c) || c == '_' || c == '$'; }
+	static bool isIdentifierPart(const int c) { return std::isalnum(c) || c == '_' || c == '$'; }
+
+	template <typename Sax>
+	void parseValue(Sax &sax, const std::size_t depth)
+	{
+		if (depth > maxDepth)
+			error("json too deep");
+
+		const int c = peek();
+		bool ok = true;
+		if (c == '{')
+			ok = parseObject(sax, depth);
+		else if (c == '[')
+			ok = parseArray(sax, depth);
+		else if (c == '"' || c == '\'')
+		{
+			parseString();
+			ok = sax.string(_token);
+		}
+		else if (c == '-' || c == '+' || c == '.' || std::isdigit(c))
+			ok = parseNumber(sax);
+		else if (isIdentifierStart(c))
+		{
+			parseIdentifier();
+			if (_token == "true")
+				ok = sax.boolean(true);
+			else if (_token == "false")
+				ok = sax.boolean(false);
+			else if (_token == "null")
+				ok = sax.null();
+			else
+				error(std::format("unexpected literal '{}'", _token));
+		}
+		else if (c == eof)
+			error("unexpected end of input");
+		else
+			error(std::format("unexpected character '{}'", static_cast<char>(c)));
+
+		if (!ok)
+			error("rejected by the SAX handler");
+	}
+
+	template <typename Sax>
+	bool parseObject(Sax &sax, const std::size_t depth)
+	{
+		get(); // {
+		if (!sax.start_object(static_cast<std::size_t>(-1)))
+			return false;
+		skipWhitespacesAndComments();
+		while (peek() != '}')
+		{
+			const int c = peek();
+			if (c == '"' || c == '\'')
+				parseString();
+			else if (isIdentifierStart(c))
+				parseIdentifier();
+			else
+				error("expected an object key");
+			if (!sax.key(_token))
+				return false;
+
+			skipWhitespacesAndComments();
+			expect(':');
+			skipWhitespacesAndComments();
+			parseValue(sax, depth + 1);
+			skipWhitespacesAndComments();
+			if (peek() == ',')
+			{
+				get();
+				skipWhitespacesAndComments(); // virgola finale ammessa
+			}
+			else if (peek() != '}')
+				error("expected ',' or '}'");
+		}
+		get(); // }
+		return sax.end_object();
+	}
+
+	template <typename Sax>
+	bool parseArray(Sax &sax, const std::size_t depth)
+	{
+		get(); // [
+		if (!sax.start_array(static_cast<std::size_t>(-1)))
+			return false;
+		skipWhitespacesAndComments();
+		while (peek() != ']')
+		{
+			parseValue(sax, depth + 1);
+			skipWhitespacesAndComments();
+			if (peek() == ',')
+			{
+				get();
+				skipWhitespacesAndComments(); // virgola finale ammessa
+			}
+			else if (peek() != ']')
+				error("expected ',' or ']'");
+		}
+		get(); // ]
+		return sax.end_array();
+	}
+
+	void parseIdentifier()
+	{
+		_token.clear();
+		while (isIdentifierPart(peek()))
+			_token.push_back(static_cast<char>(get()));
+	}
+
+	unsigned parseHex4()
+	{
+		unsigned value = 0;
+		for (int index = 0; index < 4; index++)
+		{
+			const int c = get();
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+				value |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				value |= c - 'A' + 10;
+			else
+				error("invalid \\u escape");
+		}
+		return value;
+	}
+
+	void appendUtf8(const unsigned codePoint)
+	{
+		if (codePoint < 0x80)
+			_token.push_back(static_cast<char>(codePoint));
+		else if (codePoint < 0x800)
+		{
+			_token.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+			_token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000)
+		{
+			_token.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+			_token.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			_token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else
+		{
+			_token.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+			_token.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+			_token.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			_token.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+	}
+
+	void parseString()
+	{
+		const int quote = get();
+		_token.clear();
+		for (;;)
+		{
+			int c = get();
+			if (c == quote)
+				return;
+			if (c == eof)
+				error("unterminated string");
+			if (c == '\n')
+				error("new line inside a string");
+			if (c != '\\')
+			{
+				_token.push_back(static_cast<char>(c));
+				continue;
+			}
+
+			c = get();
+			switch (c)
+			{
+			case '"':
+			case '\'':
+			case '\\':
+			case '/':
+				_token.push_back(static_cast<char>(c));
+				break;
+			case 'b':
+				_token.push_back('\b');
+				break;
+			case 'f':
+				_token.push_back('\f');
+				break;
+			case 'n':
+				_token.push_back('\n');
+				break;
+			case 'r':
+				_token.push_back('\r');
+				break;
+			case 't':
+				_token.push_back('\t');
+				break;
+			case '\n': // JSON5: continuazione di riga
+				break;
+			case 'u':
+			{
+				unsigned codePoint = parseHex4();
+				if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+				{
+					if (get() != '\\' || get() != 'u')
+						error("invalid surrogate pair");
+					const unsigned low = parseHex4();
+					if (low < 0xDC00 || low > 0xDFFF)
+						error("invalid surrogate pair");
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(codePoint);
+				break;
+			}
+			default:
+				error("invalid escape sequence");
+			}
+		}
+	}
+
+	template <typename Sax>
+	bool parseNumber(Sax &sax)
+	{
+		_token.clear();
+		if (peek() == '+') // JSON5
+			get();
+		bool isFloat = false;
+		for (int c = peek(); std::isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = peek())
+		{
+			isFloat = isFloat || c == '.' || c == 'e' || c == 'E';
+			_token.push_back(static_cast<char>(get()));
+		}
+
+		const char *begin = _token.data();
+		const char *end = _token.data() + _token.size();
+		if (!isFloat)
+		{
+			if (_token.starts_with('-'))
+			{
+				std::int64_t value;
+				auto [ptr, ec] = std::from_chars(begin, end, value);
+				if (ec == std::errc() && ptr == end)
+					return sax.number_integer(value);
+			}
+			else
+			{
+				std::uint64_t value;
+				auto [ptr, ec] = std::from_chars(begin, end, value);
+				if (ec == std::errc() && ptr == end)
+					return sax.number_unsigned(value);
+			}
+			// overflow: come nlohmann diventa un float
+		}
+
+		double value;
+		auto [ptr, ec] = std::from_chars(begin, end, value);
+		if (ptr != end || (ec != std::errc() && ec != std::errc::result_out_of_range) || _token.empty())
+			error(std::format("invalid number '{}'", _token));
+		return sax.number_float(value, _token);
+	}
+};
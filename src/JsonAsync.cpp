@@ -0,0 +1,66 @@
+#include "JsonAsync.h"
+#include <algorithm>
+
+namespace
+{
+thread_local JsonExecutor *currentExecutor = nullptr;
+}
+
+JsonExecutor *JsonExecutor::current() noexcept { return currentExecutor; }
+
+JsonExecutor::CurrentScope::CurrentScope(JsonExecutor *executor) noexcept : _previous(currentExecutor) { currentExecutor = executor; }
+
+JsonExecutor::CurrentScope::~CurrentScope() { currentExecutor = _previous; }
+
+JsonThreadPool::JsonThreadPool(std::size_t threadsNumber)
+{
+	if (threadsNumber == 0)
+		threadsNumber = std::max(1U, std::thread::hardware_concurrency());
+	_threads.reserve(threadsNumber);
+	for (std::size_t index = 0; index < threadsNumber; index++)
+		_threads.emplace_back([this]() { run(); });
+}
+
+JsonThreadPool::~JsonThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+JsonThreadPool &JsonThreadPool::shared()
+{
+	static JsonThreadPool pool;
+	return pool;
+}
+
+void JsonThreadPool::post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> locker(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_condition.notify_one();
+}
+
+void JsonThreadPool::run()
+{
+	CurrentScope currentScope(this);
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> locker(_mutex);
+			_condition.wait(locker, [this]() { return _stopping || !_tasks.empty(); });
+			if (_tasks.empty())
+				return;
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task();
+	}
+}
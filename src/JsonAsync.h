@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "JSONUtils.h"
+
+// Executor su cui JsonAsync::parseAsync/loadConfigurationFileAsync eseguono il lavoro e riprendono la coroutine.
+// Un event loop si integra implementando post e dichiarandosi executor corrente del suo thread con CurrentScope:
+// la coroutine che fa co_await viene ripresa sull'executor corrente del thread che l'ha sospesa (se non c'è,
+// sul thread che ha completato il lavoro)
+class JsonExecutor
+{
+public:
+	virtual ~JsonExecutor() = default;
+
+	virtual void post(std::function<void()> task) = 0;
+
+	static JsonExecutor *current() noexcept;
+
+	class CurrentScope
+	{
+	public:
+		explicit CurrentScope(JsonExecutor *executor) noexcept;
+		~CurrentScope();
+
+		CurrentScope(const CurrentScope &) = delete;
+		CurrentScope &operator=(const CurrentScope &) = delete;
+
+	private:
+		JsonExecutor *_previous;
+	};
+};
+
+// Pool di thread di default. Il distruttore esegue i task ancora in coda prima di terminare i thread
+class JsonThreadPool : public JsonExecutor
+{
+public:
+	// threadsNumber 0: hardware_concurrency
+	explicit JsonThreadPool(std::size_t threadsNumber = 0);
+	~JsonThreadPool() override;
+
+	JsonThreadPool(const JsonThreadPool &) = delete;
+	JsonThreadPool &operator=(const JsonThreadPool &) = delete;
+
+	static JsonThreadPool &shared();
+
+	void post(std::function<void()> task) override;
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<std::function<void()>> _tasks;
+	bool _stopping = false;
+	std::vector<std::thread> _threads;
+
+	void run();
+};
+
+// Risultato di co_await: esegue work su executor, poi riprende la coroutine sull'executor corrente del thread
+// che ha fatto co_await. Le eccezioni di work vengono rilanciate da co_await
+template <typename T>
+class JsonAwaitable
+{
+public:
+	JsonAwaitable(std::function<T()> work, JsonExecutor &executor) : _work(std::move(work)), _executor(&executor) {}
+
+	[[nodiscard]] bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		JsonExecutor *resumeExecutor = JsonExecutor::current();
+		// l'awaitable vive nel frame della coroutine fino alla ripresa, per cui this resta valido
+		_executor->post(
+			[this, handle, resumeExecutor]()
+			{
+				try
+				{
+					_result.emplace(_work());
+				}
+				catch (...)
+				{
+					_exception = std::current_exception();
+				}
+				if (resumeExecutor != nullptr)
+					resumeExecutor->post([handle]() { handle.resume(); });
+				else
+					handle.resume();
+			}
+		);
+	}
+
+	T await_resume()
+	{
+		if (_exception)
+			std::rethrow_exception(_exception);
+		return std::move(*_result);
+	}
+
+private:
+	std::function<T()> _work;
+	JsonExecutor *_executor;
+	std::optional<T> _result;
+	std::exception_ptr _exception;
+};
+
+// Versioni awaitable di JSONUtils::toJson e JSONUtils::loadConfigurationFile per le coroutine: lettura e parsing
+// vengono eseguiti su executor (di default il JsonThreadPool condiviso) e la coroutine viene ripresa sull'executor
+// corrente del thread che ha fatto co_await (vedi JsonExecutor::CurrentScope), per cui l'event loop non resta mai
+// bloccato. Gli errori vengono rilanciati da co_await come nelle versioni sincrone
+//
+//	json configuration = co_await JsonAsync::loadConfigurationFileAsync<json>(pathName, "MYAPP_");
+class JsonAsync
+{
+public:
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static JsonAwaitable<J> parseAsync(std::string text, const bool warningIfError = false, JsonExecutor &executor = JsonThreadPool::shared())
+	{
+		return JsonAwaitable<J>([text = std::move(text), warningIfError]() { return JSONUtils::toJson<J>(text, warningIfError); }, executor);
+	}
+
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	static JsonAwaitable<J> loadConfigurationFileAsync(std::string configurationPathName, std::string environmentPrefix = "",
+		const JSONUtils::ConfigurationFormat format = JSONUtils::ConfigurationFormat::Json, JsonExecutor &executor = JsonThreadPool::shared())
+	{
+		return JsonAwaitable<J>(
+			[configurationPathName = std::move(configurationPathName), environmentPrefix = std::move(environmentPrefix), format]()
+			{ return JSONUtils::loadConfigurationFile<J>(configurationPathName, environmentPrefix, format); },
+			executor
+		);
+	}
+};
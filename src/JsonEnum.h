@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Tabella nome -> enum costruita a compile time con un perfect hash a due livelli (hash and displace):
+// la ricerca calcola un solo hash del nome, legge lo spiazzamento del suo bucket e confronta al massimo
+// una stringa. Nessuna allocazione.
+//
+// Uso:
+//	enum class Color { Red, Green, Blue };
+//	template <> struct JsonEnum<Color>
+//	{
+//		static constexpr auto table = makeJsonEnumTable<Color>({{"red", Color::Red}, {"green", Color::Green}, {"blue", Color::Blue}});
+//	};
+//	Color c = JSONUtils::asEnum(root, "color", Color::Red);
+template <typename E, std::size_t N>
+requires std::is_enum_v<E> && (N > 0)
+class JsonEnumTable
+{
+public:
+	using Entry = std::pair<std::string_view, E>;
+
+	consteval explicit JsonEnumTable(const std::array<Entry, N> &values) : _values(values)
+	{
+		std::array<std::uint64_t, N> hashes{};
+		std::array<std::size_t, N> bucketOf{};
+		std::array<std::size_t, bucketsCount> bucketSize{};
+		for (std::size_t index = 0; index < N; index++)
+		{
+			for (std::size_t other = 0; other < index; other++)
+			{
+				if (_values[other].first == _values[index].first)
+					throw std::invalid_argument("JsonEnumTable: duplicated name");
+			}
+			hashes[index] = hash(_values[index].first);
+			bucketOf[index] = hashes[index] & (bucketsCount - 1);
+			bucketSize[bucketOf[index]]++;
+		}
+
+		_slots.fill(emptySlot);
+		_displacements.fill(0);
+
+		// i bucket più popolati per primi, quando gli slot liberi sono ancora molti
+		std::array<bool, bucketsCount> placed{};
+		for (std::size_t step = 0; step < bucketsCount; step++)
+		{
+			std::size_t bucket = bucketsCount;
+			for (std::size_t candidate = 0; candidate < bucketsCount; candidate++)
+			{
+				if (!placed[candidate] && (bucket == bucketsCount || bucketSize[candidate] > bucketSize[bucket]))
+					bucket = candidate;
+			}
+			placed[bucket] = true;
+			if (bucketSize[bucket] == 0)
+				break;
+
+			std::uint32_t displacement = 1;
+			for (;; displacement++)
+			{
+				if (displacement > maxDisplacement)
+					throw std::invalid_argument("JsonEnumTable: perfect hash not found");
+
+				std::array<std::size_t, N> used{};
+				std::size_t usedCount = 0;
+				bool collision = false;
+				for (std::size_t index = 0; index < N && !collision; index++)
+				{
+					if (bucketOf[index] != bucket)
+						continue;
+					const std::size_t slot = slotOf(hashes[index], displacement);
+					if (_slots[slot] != emptySlot)
+						collision = true;
+					for (std::size_t u = 0; u < usedCount && !collision; u++)
+						collision = used[u] == slot;
+					used[usedCount++] = slot;
+				}
+				if (!collision)
+					break;
+			}
+
+			_displacements[bucket] = displacement;
+			for (std::size_t index = 0; index < N; index++)
+			{
+				if (bucketOf[index] == bucket)
+					_slots[slotOf(hashes[index], displacement)] = static_cast<std::uint32_t>(index);
+			}
+		}
+	}
+
+	[[nodiscard]] constexpr std::optional<E> find(const std::string_view name) const noexcept
+	{
+		const std::uint64_t h = hash(name);
+		const std::uint32_t index = _slots[slotOf(h, _displacements[h & (bucketsCount - 1)])];
+		if (index == emptySlot || _values[index].first != name)
+			return std::nullopt;
+		return _values[index].second;
+	}
+
+	[[nodiscard]] constexpr bool contains(const std::string_view name) const noexcept { return find(name).has_value(); }
+
+	[[nodiscard]] constexpr std::optional<std::string_view> name(const E value) const noexcept
+	{
+		for (const auto &[n, v] : _values)
+		{
+			if (v == value)
+				return n;
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] constexpr const std::array<Entry, N> &values() const noexcept { return _values; }
+
+private:
+	static constexpr std::size_t bucketsCount = std::bit_ceil(N);
+	static constexpr std::size_t slotsCount = 2 * std::bit_ceil(N);
+	static constexpr std::uint32_t emptySlot = UINT32_MAX;
+	static constexpr std::uint32_t maxDisplacement = 1 << 20;
+
+	std::array<Entry, N> _values;
+	std::array<std::uint32_t, bucketsCount> _displacements{};
+	std::array<std::uint32_t, slotsCount> _slots{};
+
+	// FNV-1a
+	static constexpr std::uint64_t hash(const std::string_view name) noexcept
+	{
+		std::uint64_t h = 14695981039346656037ULL;
+		for (const char c : name)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	// finalizer di splitmix64 applicato all'hash spiazzato
+	static constexpr std::size_t slotOf(std::uint64_t h, const std::uint32_t displacement) noexcept
+	{
+		h += displacement * 0x9E3779B97F4A7C15ULL;
+		h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+		h ^= h >> 31;
+		return h & (slotsCount - 1);
+	}
+};
+
+template <typename E, std::size_t N>
+consteval JsonEnumTable<E, N> makeJsonEnumTable(const std::pair<std::string_view, E> (&values)[N])
+{
+	std::array<std::pair<std::string_view, E>, N> entries;
+	for (std::size_t index = 0; index < N; index++)
+		entries[index] = values[index];
+	return JsonEnumTable<E, N>(entries);
+}
+
+// Da specializzare per ogni enum con un membro "static constexpr auto table = makeJsonEnumTable<E>({...});"
+template <typename E>
+struct JsonEnum;
+
+template <typename E>
+concept JsonMappedEnum = std::is_enum_v<E> && requires {
+	{ JsonEnum<E>::table.find(std::string_view{}) } -> std::same_as<std::optional<E>>;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JSONUtils.h"
+
+// Cache LRU (opzionale) dei parsing di JSONUtils::toJson per i testi che vengono parsati molte volte
+// (settings salvati su DB, template, ...). Un hit ritorna lo stesso documento già parsato, senza parsing né copie.
+// La chiave è l'hash del testo; in caso di collisione viene confrontato il testo completo.
+// È suddivisa in shard, ognuno con il suo mutex, e il limite è espresso in byte (testo + DOM misurato con JSONUtils::memoryUsage).
+//
+//	static JsonParseCache<json> settingsCache(64 * 1024 * 1024);
+//	std::shared_ptr<const json> settings = settingsCache.toJson(row.settings);
+template <typename J>
+requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+class JsonParseCache
+{
+public:
+	struct Stats
+	{
+		std::uint64_t hits = 0;
+		std::uint64_t misses = 0;
+		std::uint64_t evictions = 0;
+		std::size_t entries = 0;
+		std::size_t bytes = 0;
+	};
+
+	explicit JsonParseCache(const std::size_t maxBytes, const std::size_t shardsNumber = 16)
+		: _shards(std::bit_ceil(std::max<std::size_t>(shardsNumber, 1)))
+	{
+		_maxBytesPerShard = maxBytes / _shards.size();
+	}
+
+	JsonParseCache(const JsonParseCache &) = delete;
+	JsonParseCache &operator=(const JsonParseCache &) = delete;
+
+	// come JSONUtils::toJson (stessa gestione degli errori, che non vengono memorizzati in cache)
+	[[nodiscard]] std::shared_ptr<const J> toJson(const std::string_view text, const bool warningIfError = false)
+	{
+		const std::uint64_t hash = JSONUtils::hashText(text);
+		Shard &shard = _shards[hash & (_shards.size() - 1)];
+
+		{
+			std::lock_guard<std::mutex> locker(shard.mutex);
+			if (std::shared_ptr<const J> root = shard.find(hash, text))
+			{
+				_hits.fetch_add(1, std::memory_order_relaxed);
+				return root;
+			}
+		}
+		_misses.fetch_add(1, std::memory_order_relaxed);
+
+		// il parsing viene fatto fuori dal lock per non bloccare gli altri testi dello stesso shard
+		auto root = std::make_shared<const J>(JSONUtils::toJson<J>(text, warningIfError));
+		const std::size_t bytes = sizeof(Entry) + text.size() + JSONUtils::memoryUsage(*root).totalBytes;
+		if (bytes > _maxBytesPerShard)
+			return root;
+
+		std::lock_guard<std::mutex> locker(shard.mutex);
+		// nel frattempo un altro thread potrebbe averlo già inserito
+		if (std::shared_ptr<const J> cached = shard.find(hash, text))
+			return cached;
+		shard.lru.push_front(Entry{hash, std::string(text), root, bytes});
+		shard.index.emplace(hash, shard.lru.begin());
+		shard.bytes += bytes;
+		while (shard.bytes > _maxBytesPerShard)
+		{
+			shard.evictLast();
+			_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+		return root;
+	}
+
+	[[nodiscard]] Stats stats() const
+	{
+		Stats stats;
+		stats.hits = _hits.load(std::memory_order_relaxed);
+		stats.misses = _misses.load(std::memory_order_relaxed);
+		stats.evictions = _evictions.load(std::memory_order_relaxed);
+		for (const Shard &shard : _shards)
+		{
+			std::lock_guard<std::mutex> locker(shard.mutex);
+			stats.entries += shard.lru.size();
+			stats.bytes += shard.bytes;
+		}
+		return stats;
+	}
+
+	void clear()
+	{
+		for (Shard &shard : _shards)
+		{
+			std::lock_guard<std::mutex> locker(shard.mutex);
+			shard.lru.clear();
+			shard.index.clear();
+			shard.bytes = 0;
+		}
+	}
+
+private:
+	struct Entry
+	{
+		std::uint64_t hash;
+		std::string text;
+		std::shared_ptr<const J> root;
+		std::size_t bytes;
+	};
+
+	struct Shard
+	{
+		mutable std::mutex mutex;
+		std::list<Entry> lru; // in testa il più recente
+		std::unordered_multimap<std::uint64_t, typename std::list<Entry>::iterator> index;
+		std::size_t bytes = 0;
+
+		// da chiamare con il lock preso, sposta l'elemento trovato in testa
+		std::shared_ptr<const J> find(const std::uint64_t hash, const std::string_view text)
+		{
+			auto [begin, end] = index.equal_range(hash);
+			for (auto it = begin; it != end; ++it)
+			{
+				if (it->second->text == text)
+				{
+					lru.splice(lru.begin(), lru, it->second);
+					return it->second->root;
+				}
+			}
+			return nullptr;
+		}
+
+		void evictLast()
+		{
+			auto last = std::prev(lru.end());
+			auto [begin, end] = index.equal_range(last->hash);
+			for (auto it = begin; it != end; ++it)
+			{
+				if (it->second == last)
+				{
+					index.erase(it);
+					break;
+				}
+			}
+			bytes -= last->bytes;
+			lru.pop_back();
+		}
+	};
+
+	std::vector<Shard> _shards;
+	std::size_t _maxBytesPerShard;
+	std::atomic<std::uint64_t> _hits{0};
+	std::atomic<std::uint64_t> _misses{0};
+	std::atomic<std::uint64_t> _evictions{0};
+};
@@ -7,6 +7,11 @@
 #include <type_traits>
 #include <cstddef>   // size_t
 #include <format>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+#include <variant>
 
 #include "JSONUtils.h"
 
@@ -27,20 +32,21 @@ public:
 
     [[nodiscard]] JsonPath required() const
     {
-        return JsonPath(_root, AccessMode::Required, _path);
+        return JsonPath(_root, AccessMode::Required, path());
     }
 
     [[nodiscard]] JsonPath optional() const
     {
-        return JsonPath(_root, AccessMode::Optional, _path);
+        return JsonPath(_root, AccessMode::Optional, path());
     }
 
 	[[nodiscard]] JsonPath operator[](const std::string& key) const
 	{
 		// Path tipo "a.b.c"
-		std::string nextPath = _path.empty()
+		const std::string currentPath = path();
+		std::string nextPath = currentPath.empty()
 			? std::string(key)
-			: std::format("{}.{}", _path, key);
+			: std::format("{}.{}", currentPath, key);
 
 		if (!_root || !_root->is_object())
 			return jsonPathMissing(nextPath);
@@ -57,9 +63,10 @@ public:
 
 	[[nodiscard]] JsonPath operator[](std::size_t index) const
     {
-        std::string nextPath = _path.empty()
+        const std::string currentPath = path();
+        std::string nextPath = currentPath.empty()
             ? std::format("[{}]", index)
-            : std::format("{}[{}]", _path, index);
+            : std::format("{}[{}]", currentPath, index);
 
         if (!_root || !_root->is_array() || index >= _root->size())
             return jsonPathMissing(nextPath);
@@ -95,7 +102,7 @@ public:
         if (!_root)
         {
             if (_mode == AccessMode::Required)
-                throw JsonFieldNotFound(std::format("Missing required JSON field: {}", _path));
+                throw JsonFieldNotFound(std::format("Missing required JSON field: {}", path()));
             return defaultValue;
         }
     	try
@@ -104,7 +111,7 @@ public:
     	}
     	catch (const std::exception &e)
     	{
-    		const std::string errorMessage = std::format("Error accessing JSON field '{}': {}", _path, e.what());
+    		const std::string errorMessage = std::format("Error accessing JSON field '{}': {}", path(), e.what());
     		LOG_ERROR(errorMessage);
     		throw std::runtime_error(errorMessage);
     	}
@@ -115,7 +122,7 @@ public:
     {
         if (!_root) {
             if (_mode == AccessMode::Required)
-                throw JsonFieldNotFound(std::format("Missing required JSON field: {}", _path));
+                throw JsonFieldNotFound(std::format("Missing required JSON field: {}", path()));
             return std::nullopt;
         }
     	try
@@ -124,24 +131,153 @@ public:
     	}
     	catch (const std::exception &e)
     	{
-    		const std::string errorMessage = std::format("Error accessing JSON field '{}': {}", _path, e.what());
+    		const std::string errorMessage = std::format("Error accessing JSON field '{}': {}", path(), e.what());
     		LOG_ERROR(errorMessage);
     		throw std::runtime_error(errorMessage);
     	}
     }
 
+	// Viste non copianti sui figli del nodo: i JsonPath/string_view restituiti puntano direttamente
+	// nel DOM originale, quindi il DOM deve sopravvivere alla vista.
+	// Un nodo mancante o di tipo diverso produce una vista vuota (eccezione in modalità Required se il nodo manca).
+	template <typename V>
+	class ChildView : public std::ranges::view_interface<ChildView<V>>
+	{
+	public:
+		class iterator
+		{
+		public:
+			using value_type = V;
+			using difference_type = std::ptrdiff_t;
+			using iterator_concept = std::forward_iterator_tag;
+
+			iterator() = default;
+
+			[[nodiscard]] V operator*() const
+			{
+				// il path del figlio viene costruito solo se richiesto (JsonPath::path), nessuna allocazione per elemento
+				if constexpr (std::is_same_v<V, JsonPath>)
+					return JsonPath(&(*_it), _mode, _parentPath, _index);
+				else if constexpr (std::is_same_v<V, std::string_view>)
+					return std::string_view(_it.key());
+				else
+				{
+					const std::string_view key = _it.key();
+					return V(key, JsonPath(&_it.value(), _mode, _parentPath, key));
+				}
+			}
+
+			iterator& operator++()
+			{
+				++_it;
+				++_index;
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator tmp = *this;
+				++*this;
+				return tmp;
+			}
+
+			[[nodiscard]] bool operator==(const iterator& other) const { return _index == other._index; }
+
+		private:
+			friend class ChildView;
+
+			// nessun puntatore alla vista: l'iteratore resta valido anche se la vista viene copiata o spostata
+			typename J::const_iterator _it;
+			AccessMode _mode = AccessMode::Optional;
+			std::shared_ptr<const std::string> _parentPath;
+			std::size_t _index = 0;
+
+			iterator(typename J::const_iterator it, const AccessMode mode, std::shared_ptr<const std::string> parentPath, const std::size_t index)
+				: _it(it), _mode(mode), _parentPath(std::move(parentPath)), _index(index)
+			{}
+		};
+
+		ChildView() = default;
+
+		[[nodiscard]] iterator begin() const { return iterator(_container->cbegin(), _mode, _path, 0); }
+		[[nodiscard]] iterator end() const { return iterator(_container->cend(), _mode, _path, _container->size()); }
+		[[nodiscard]] std::size_t size() const noexcept { return _container->size(); }
+
+	private:
+		friend class JsonPath;
+
+		const J* _container = &emptyContainer();
+		AccessMode _mode = AccessMode::Optional;
+		// condiviso con iteratori e figli
+		std::shared_ptr<const std::string> _path = std::make_shared<const std::string>();
+
+		ChildView(const J* container, const AccessMode mode, std::string path)
+			: _container(container), _mode(mode), _path(std::make_shared<const std::string>(std::move(path)))
+		{}
+	};
+
+	using ElementsView = ChildView<JsonPath>;
+	using MembersView = ChildView<std::pair<std::string_view, JsonPath>>;
+	using KeysView = ChildView<std::string_view>;
+
+	// for (const auto& item : JsonPath(&root)["list"].elements())
+	[[nodiscard]] ElementsView elements() const
+	{
+		return childView<JsonPath>(_root && _root->is_array());
+	}
+
+	// for (const auto& [key, value] : JsonPath(&root)["obj"].members())
+	[[nodiscard]] MembersView members() const
+	{
+		return childView<std::pair<std::string_view, JsonPath>>(_root && _root->is_object());
+	}
+
+	[[nodiscard]] KeysView keysView() const
+	{
+		return childView<std::string_view>(_root && _root->is_object());
+	}
+
     [[nodiscard]] const J* get() const noexcept { return _root; }
-    [[nodiscard]] std::string path() const noexcept { return _path; }
+    [[nodiscard]] std::string path() const
+    {
+    	if (!_parentPath)
+    		return _path;
+    	if (const std::size_t* index = std::get_if<std::size_t>(&_child))
+    		return _parentPath->empty() ? std::format("[{}]", *index) : std::format("{}[{}]", *_parentPath, *index);
+    	const std::string_view key = std::get<std::string_view>(_child);
+    	return _parentPath->empty() ? std::string(key) : std::format("{}.{}", *_parentPath, key);
+    }
 
 private:
     const J* _root;
     AccessMode _mode;
     std::string _path;
+	// figli prodotti dalle viste: path del padre + indice/chiave, il path completo è costruito da path()
+	std::shared_ptr<const std::string> _parentPath;
+	std::variant<std::size_t, std::string_view> _child;
 
 	explicit JsonPath(const J* j, const AccessMode mode, std::string path)
 		: _root(j), _mode(mode), _path(std::move(path))
 	{}
 
+	JsonPath(const J* j, const AccessMode mode, std::shared_ptr<const std::string> parentPath, std::variant<std::size_t, std::string_view> child)
+		: _root(j), _mode(mode), _parentPath(std::move(parentPath)), _child(child)
+	{}
+
+	static const J& emptyContainer()
+	{
+		static const J empty = J::array();
+		return empty;
+	}
+
+	template <typename V>
+	[[nodiscard]] ChildView<V> childView(const bool kindMatches) const
+	{
+		if (!_root && _mode == AccessMode::Required)
+			throw JsonFieldNotFound(std::format("Missing required JSON field: {}", path()));
+		return ChildView<V>(kindMatches ? _root : &emptyContainer(), _mode, path());
+	}
+
     [[nodiscard]] JsonPath jsonPathMissing(const std::string& nextPath) const
     {
         if (_mode == AccessMode::Required)
@@ -149,3 +285,7 @@ private:
         return JsonPath(nullptr, _mode, nextPath);
     }
 };
+
+// istanziate in JSONUtils.cpp
+extern template class JsonPath<nlohmann::json>;
+extern template class JsonPath<nlohmann::ordered_json>;
@@ -0,0 +1,89 @@
+#include "JsonRecord.h"
+#include <algorithm>
+
+std::optional<std::size_t> JsonShape::indexOf(const std::string_view key) const
+{
+	auto it = std::ranges::lower_bound(sortedKeys, key, {}, [](const auto &k) { return k.first; });
+	if (it == sortedKeys.end() || it->first != key)
+		return std::nullopt;
+	return it->second;
+}
+
+std::optional<std::size_t> JsonShape::indexOf(const std::string *internedKey) const
+{
+	auto it = std::ranges::find(keys, internedKey);
+	if (it == keys.end())
+		return std::nullopt;
+	return static_cast<std::size_t>(it - keys.begin());
+}
+
+const JsonShape &JsonShape::empty()
+{
+	static const JsonShape shape;
+	return shape;
+}
+
+JsonKeyPool &JsonKeyPool::shared()
+{
+	static JsonKeyPool pool;
+	return pool;
+}
+
+const std::string *JsonKeyPool::intern(const std::string_view key)
+{
+	std::lock_guard<std::mutex> locker(_mutex);
+	return internLocked(key);
+}
+
+const std::string *JsonKeyPool::internLocked(const std::string_view key)
+{
+	auto it = _keys.find(key);
+	if (it == _keys.end())
+		it = _keys.emplace(key).first;
+	return &(*it);
+}
+
+const JsonShape *JsonKeyPool::shape(const std::span<const std::string_view> keys)
+{
+	std::lock_guard<std::mutex> locker(_mutex);
+
+	std::vector<const std::string *> internedKeys;
+	internedKeys.reserve(keys.size());
+	for (const std::string_view key : keys)
+		internedKeys.push_back(internLocked(key));
+
+	auto it = _shapes.find(internedKeys);
+	if (it != _shapes.end())
+		return it->second.get();
+
+	auto shape = std::make_unique<JsonShape>();
+	shape->keys = internedKeys;
+	shape->sortedKeys.reserve(internedKeys.size());
+	for (std::uint32_t index = 0; index < internedKeys.size(); index++)
+		shape->sortedKeys.emplace_back(*internedKeys[index], index);
+	std::ranges::sort(shape->sortedKeys);
+
+	const JsonShape *result = shape.get();
+	_shapes.emplace(std::move(internedKeys), std::move(shape));
+	return result;
+}
+
+std::size_t JsonKeyPool::keysNumber() const
+{
+	std::lock_guard<std::mutex> locker(_mutex);
+	return _keys.size();
+}
+
+std::size_t JsonKeyPool::shapesNumber() const
+{
+	std::lock_guard<std::mutex> locker(_mutex);
+	return _shapes.size();
+}
+
+std::size_t JsonKeyPool::ShapeHash::operator()(const std::vector<const std::string *> &keys) const noexcept
+{
+	std::size_t h = keys.size();
+	for (const std::string *key : keys)
+		h = h * 31 + std::hash<const std::string *>{}(key);
+	return h;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "JsonPath.h"
+
+// Insieme di chiavi (in ordine) condiviso da tutti i record con le stesse chiavi.
+// Le chiavi sono internate nel JsonKeyPool, per cui due chiavi uguali hanno lo stesso indirizzo
+struct JsonShape
+{
+	std::vector<const std::string *> keys;
+	std::vector<std::pair<std::string_view, std::uint32_t>> sortedKeys; // per la ricerca binaria
+
+	[[nodiscard]] std::optional<std::size_t> indexOf(std::string_view key) const;
+	// confronto tra puntatori, per chiavi già internate con JsonKeyPool::intern
+	[[nodiscard]] std::optional<std::size_t> indexOf(const std::string *internedKey) const;
+
+	// shape senza chiavi, ad es. di un JsonRecord spostato
+	static const JsonShape &empty();
+};
+
+// Pool thread-safe di chiavi e di JsonShape. Chiavi e shape non vengono mai liberate: il pool è pensato per
+// i (pochi) nomi di campo ricorrenti, non per chiavi arbitrarie
+class JsonKeyPool
+{
+public:
+	static JsonKeyPool &shared();
+
+	const std::string *intern(std::string_view key);
+	const JsonShape *shape(std::span<const std::string_view> keys);
+
+	[[nodiscard]] std::size_t keysNumber() const;
+	[[nodiscard]] std::size_t shapesNumber() const;
+
+private:
+	struct KeyHash
+	{
+		using is_transparent = void;
+		std::size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+	};
+
+	struct ShapeHash
+	{
+		std::size_t operator()(const std::vector<const std::string *> &keys) const noexcept;
+	};
+
+	mutable std::mutex _mutex;
+	std::unordered_set<std::string, KeyHash, std::equal_to<>> _keys; // nodi stabili: gli indirizzi non cambiano
+	std::unordered_map<std::vector<const std::string *>, std::unique_ptr<JsonShape>, ShapeHash> _shapes;
+
+	const std::string *internLocked(std::string_view key);
+};
+
+// Oggetto json compatto per tenere in memoria molti record piccoli con le stesse chiavi: invece di un
+// std::map/ordered_map con una std::string per ogni chiave di ogni record, il record contiene solo il puntatore
+// alla sua JsonShape (condivisa) e l'array dei valori. Le chiavi sono solo quelle del primo livello, i valori
+// sono normali J e si leggono con JSONUtils::as, JSONUtils::isPresent e JsonPath.
+//
+//	JsonRecord<json> record(JSONUtils::toJson<json>(row));
+//	double price = record.as<double>("price", 0.0);
+//	int32_t port = record["server"]["port"].as<int32_t>(80);
+template <typename J>
+requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+class JsonRecord
+{
+public:
+	explicit JsonRecord(J object, JsonKeyPool &pool = JsonKeyPool::shared())
+	{
+		if (!object.is_object())
+		{
+			const std::string errorMessage = std::format("JsonRecord requires a json object, received: {}", object.type_name());
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+
+		std::vector<std::string_view> keys;
+		keys.reserve(object.size());
+		for (auto it = object.begin(); it != object.end(); ++it)
+			keys.emplace_back(it.key());
+		_shape = pool.shape(keys);
+
+		_values = std::make_unique<J[]>(keys.size());
+		std::size_t index = 0;
+		for (auto it = object.begin(); it != object.end(); ++it)
+			_values[index++] = std::move(it.value());
+	}
+
+	JsonRecord(const JsonRecord &other) : _shape(other._shape), _values(std::make_unique<J[]>(other.size()))
+	{
+		std::copy_n(other._values.get(), other.size(), _values.get());
+	}
+	// il record spostato resta valido e vuoto
+	JsonRecord(JsonRecord &&other) noexcept
+		: _shape(std::exchange(other._shape, &JsonShape::empty())), _values(std::move(other._values))
+	{}
+	JsonRecord &operator=(JsonRecord other) noexcept
+	{
+		std::swap(_shape, other._shape);
+		std::swap(_values, other._values);
+		return *this;
+	}
+
+	[[nodiscard]] std::size_t size() const noexcept { return _shape->keys.size(); }
+	[[nodiscard]] const JsonShape &shape() const noexcept { return *_shape; }
+	[[nodiscard]] std::string_view key(const std::size_t index) const { return *_shape->keys[index]; }
+	[[nodiscard]] const J &value(const std::size_t index) const { return _values[index]; }
+	[[nodiscard]] J &value(const std::size_t index) { return _values[index]; }
+
+	[[nodiscard]] const J *find(const std::string_view key) const
+	{
+		const std::optional<std::size_t> index = _shape->indexOf(key);
+		return index ? &_values[*index] : nullptr;
+	}
+
+	[[nodiscard]] J *find(const std::string_view key)
+	{
+		const std::optional<std::size_t> index = _shape->indexOf(key);
+		return index ? &_values[*index] : nullptr;
+	}
+
+	// chiave ottenuta da JsonKeyPool::intern: la ricerca confronta solo puntatori
+	[[nodiscard]] const J *find(const std::string *internedKey) const
+	{
+		const std::optional<std::size_t> index = _shape->indexOf(internedKey);
+		return index ? &_values[*index] : nullptr;
+	}
+
+	// stessa semantica di JSONUtils::isPresent
+	[[nodiscard]] bool isPresent(const std::string_view field, const bool checksAlsoNotNull = false) const
+	{
+		const J *value = find(field);
+		return value != nullptr && (!checksAlsoNotNull || !value->is_null());
+	}
+
+	// stessa semantica di JSONUtils::as (campo mancante o null, conversioni, allowedValues, exceptionOnError)
+	template <typename T>
+	[[nodiscard]] T as(const std::string_view field, T defaultVal = {}, std::span<const T> allowedValues = {},
+		const bool exceptionOnError = false) const
+	{
+		if (field.empty())
+			return JSONUtils::as<T>(toJson(), field, std::move(defaultVal), allowedValues, exceptionOnError);
+		return JSONUtils::asField<T>(find(field), field, std::move(defaultVal), allowedValues, exceptionOnError);
+	}
+
+	template <typename T>
+	[[nodiscard]] std::optional<T> asOpt(const std::string_view field, std::span<const T> allowedValues = {},
+		const bool exceptionOnError = false) const
+	{
+		if (field.empty())
+			return JSONUtils::asOpt<T>(toJson(), field, allowedValues, exceptionOnError);
+		return JSONUtils::asOptField<T>(find(field), field, allowedValues, exceptionOnError);
+	}
+
+	// JsonPath sul valore del campo (JsonPath mancante se il campo non c'è)
+	[[nodiscard]] JsonPath<J> operator[](const std::string_view field) const { return JsonPath<J>(find(field)); }
+
+	[[nodiscard]] J toJson() const
+	{
+		J root = J::object();
+		for (std::size_t index = 0; index < size(); index++)
+			root.emplace(*_shape->keys[index], _values[index]);
+		return root;
+	}
+
+private:
+	const JsonShape *_shape;
+	std::unique_ptr<J[]> _values;
+};
@@ -0,0 +1,315 @@
+#include "JsonSchema.h"
+#include <algorithm>
+#include <format>
+#include <utility>
+
+namespace
+{
+#ifdef __GLIBCXX__
+// l'esecutore di default di libstdc++ è ricorsivo, un livello per carattere: con stringhe di qualche centinaio di KB
+// esaurisce lo stack. __polynomial usa la simulazione dell'NFA, la cui ricorsione dipende solo dalla dimensione del
+// pattern; non ammette i backreference (compile li rifiuta)
+constexpr auto patternFlags = std::regex::ECMAScript | std::regex::optimize | std::regex_constants::__polynomial;
+#else
+constexpr auto patternFlags = std::regex::ECMAScript | std::regex::optimize;
+#endif
+} // namespace
+
+JsonSchema JsonSchema::compile(const nlohmann::json &schema)
+{
+	return JsonSchema(compileNode(schema, ""));
+}
+
+std::unique_ptr<JsonSchema::Node> JsonSchema::compileNode(const nlohmann::json &schema, const std::string &schemaPath)
+{
+	auto node = std::make_unique<Node>();
+
+	// {} e true accettano qualunque valore, false nessuno
+	if (schema.is_boolean())
+	{
+		if (!schema.get<bool>())
+			node->types = 0;
+		return node;
+	}
+	if (!schema.is_object())
+	{
+		const std::string errorMessage = std::format("Invalid JSON Schema, expected an object, schema path: {}", schemaPath);
+		LOG_ERROR(errorMessage);
+		throw std::invalid_argument(errorMessage);
+	}
+
+	// keyword che impongono vincoli e non sono implementate: ignorarle accetterebbe documenti non validi
+	for (const std::string_view keyword :
+		 {"$ref", "$dynamicRef", "$recursiveRef", "allOf", "anyOf", "oneOf", "not", "if", "patternProperties", "dependencies",
+		  "dependentSchemas", "additionalItems", "unevaluatedItems", "unevaluatedProperties"})
+	{
+		if (schema.contains(keyword))
+		{
+			const std::string errorMessage = std::format("Unsupported JSON Schema keyword '{}', schema path: {}", keyword, schemaPath);
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+	}
+
+	auto parseType = [&](const std::string &type) -> std::uint8_t
+	{
+		if (type == "null")
+			return TypeNull;
+		if (type == "boolean")
+			return TypeBoolean;
+		if (type == "integer")
+			return TypeInteger;
+		if (type == "number")
+			return TypeNumber;
+		if (type == "string")
+			return TypeString;
+		if (type == "array")
+			return TypeArray;
+		if (type == "object")
+			return TypeObject;
+		const std::string errorMessage = std::format("Unknown JSON Schema type '{}', schema path: {}", type, schemaPath);
+		LOG_ERROR(errorMessage);
+		throw std::invalid_argument(errorMessage);
+	};
+
+	if (schema.contains("type"))
+	{
+		node->types = 0;
+		if (schema["type"].is_array())
+		{
+			for (const auto &type : schema["type"])
+				node->types |= parseType(type.get<std::string>());
+		}
+		else
+			node->types = parseType(schema["type"].get<std::string>());
+	}
+
+	if (schema.contains("enum"))
+		node->enumValues = schema["enum"].get<std::vector<nlohmann::json>>();
+	if (schema.contains("const"))
+		node->enumValues = {schema["const"]};
+
+	auto parseNumber = [&](const std::string_view keyword) -> std::optional<Number>
+	{
+		auto it = schema.find(keyword);
+		if (it == schema.end())
+			return std::nullopt;
+		if (!it->is_number())
+		{
+			// exclusiveMinimum/exclusiveMaximum booleani (draft 4) sono gestiti insieme a minimum/maximum
+			if (it->is_boolean() && keyword.starts_with("exclusive"))
+				return std::nullopt;
+			const std::string errorMessage = std::format("JSON Schema keyword '{}' must be a number, schema path: {}", keyword, schemaPath);
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+		return toNumber(*it);
+	};
+	node->minimum = parseNumber("minimum");
+	node->maximum = parseNumber("maximum");
+	node->exclusiveMinimum = parseNumber("exclusiveMinimum");
+	node->exclusiveMaximum = parseNumber("exclusiveMaximum");
+	// draft 4: "exclusiveMinimum": true rende esclusivo il limite di minimum (lo stesso per maximum)
+	auto isTrue = [&](const std::string_view keyword)
+	{
+		auto it = schema.find(keyword);
+		return it != schema.end() && it->is_boolean() && it->get<bool>();
+	};
+	if (isTrue("exclusiveMinimum") && node->minimum)
+		node->exclusiveMinimum = std::exchange(node->minimum, std::nullopt);
+	if (isTrue("exclusiveMaximum") && node->maximum)
+		node->exclusiveMaximum = std::exchange(node->maximum, std::nullopt);
+	node->multipleOf = parseNumber("multipleOf");
+	if (node->multipleOf && compare(*node->multipleOf, Number(std::int64_t(0))) != std::partial_ordering::greater)
+	{
+		const std::string errorMessage = std::format("JSON Schema keyword 'multipleOf' must be greater than 0, schema path: {}", schemaPath);
+		LOG_ERROR(errorMessage);
+		throw std::invalid_argument(errorMessage);
+	}
+
+	if (schema.contains("minLength"))
+		node->minLength = schema["minLength"].get<std::size_t>();
+	if (schema.contains("maxLength"))
+		node->maxLength = schema["maxLength"].get<std::size_t>();
+	if (schema.contains("pattern"))
+	{
+		node->patternSource = schema["pattern"].get<std::string>();
+		try
+		{
+			node->pattern.emplace(node->patternSource, patternFlags);
+		}
+		catch (const std::regex_error &e)
+		{
+			const std::string errorMessage =
+				std::format("Invalid JSON Schema pattern '{}', schema path: {}, exception: {}", node->patternSource, schemaPath, e.what());
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+	}
+
+	if (schema.contains("prefixItems"))
+	{
+		if (!schema["prefixItems"].is_array())
+		{
+			const std::string errorMessage = std::format("JSON Schema keyword 'prefixItems' must be an array, schema path: {}", schemaPath);
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+		for (std::size_t index = 0; index < schema["prefixItems"].size(); index++)
+			node->prefixItems.push_back(compileNode(schema["prefixItems"][index], std::format("{}/prefixItems/{}", schemaPath, index)));
+	}
+	if (schema.contains("items"))
+		node->items = compileNode(schema["items"], std::format("{}/items", schemaPath));
+	if (schema.contains("minItems"))
+		node->minItems = schema["minItems"].get<std::size_t>();
+	if (schema.contains("maxItems"))
+		node->maxItems = schema["maxItems"].get<std::size_t>();
+	if (schema.contains("uniqueItems"))
+		node->uniqueItems = schema["uniqueItems"].get<bool>();
+	if (schema.contains("contains"))
+	{
+		node->contains = compileNode(schema["contains"], std::format("{}/contains", schemaPath));
+		if (schema.contains("minContains"))
+			node->minContains = schema["minContains"].get<std::size_t>();
+		if (schema.contains("maxContains"))
+			node->maxContains = schema["maxContains"].get<std::size_t>();
+	}
+
+	if (schema.contains("properties"))
+	{
+		// nlohmann::json itera le chiavi già ordinate
+		for (const auto &[key, value] : schema["properties"].items())
+			node->properties.emplace_back(key, compileNode(value, std::format("{}/properties/{}", schemaPath, key)));
+	}
+	if (schema.contains("required"))
+		node->required = schema["required"].get<std::vector<std::string>>();
+	if (schema.contains("dependentRequired"))
+	{
+		for (const auto &[key, value] : schema["dependentRequired"].items())
+			node->dependentRequired.emplace_back(key, value.get<std::vector<std::string>>());
+	}
+	if (schema.contains("propertyNames"))
+		node->propertyNames = compileNode(schema["propertyNames"], std::format("{}/propertyNames", schemaPath));
+	if (schema.contains("minProperties"))
+		node->minProperties = schema["minProperties"].get<std::size_t>();
+	if (schema.contains("maxProperties"))
+		node->maxProperties = schema["maxProperties"].get<std::size_t>();
+	if (schema.contains("additionalProperties"))
+	{
+		if (!schema["additionalProperties"].is_boolean())
+		{
+			const std::string errorMessage =
+				std::format("Unsupported JSON Schema keyword 'additionalProperties' (only boolean), schema path: {}", schemaPath);
+			LOG_ERROR(errorMessage);
+			throw std::invalid_argument(errorMessage);
+		}
+		node->additionalProperties = schema["additionalProperties"].get<bool>();
+	}
+
+	return node;
+}
+
+std::string JsonSchema::typesToString(const std::uint8_t types)
+{
+	std::vector<std::string_view> names;
+	if (types & TypeNull)
+		names.emplace_back("null");
+	if (types & TypeBoolean)
+		names.emplace_back("boolean");
+	if (types & TypeNumber)
+		names.emplace_back("number");
+	else if (types & TypeInteger)
+		names.emplace_back("integer");
+	if (types & TypeString)
+		names.emplace_back("string");
+	if (types & TypeArray)
+		names.emplace_back("array");
+	if (types & TypeObject)
+		names.emplace_back("object");
+	return fmt::format("{}", fmt::join(names, "|"));
+}
+
+std::partial_ordering JsonSchema::compare(const Number &a, const Number &b)
+{
+	// interi con interi: confronto esatto, senza passare da double (che perde precisione oltre 2^53)
+	if (!std::holds_alternative<double>(a) && !std::holds_alternative<double>(b))
+	{
+		if (std::holds_alternative<std::int64_t>(a) && std::holds_alternative<std::int64_t>(b))
+			return std::get<std::int64_t>(a) <=> std::get<std::int64_t>(b);
+		if (std::holds_alternative<std::uint64_t>(a) && std::holds_alternative<std::uint64_t>(b))
+			return std::get<std::uint64_t>(a) <=> std::get<std::uint64_t>(b);
+		if (const std::int64_t *signedA = std::get_if<std::int64_t>(&a))
+			return *signedA < 0 ? std::partial_ordering::less : static_cast<std::uint64_t>(*signedA) <=> std::get<std::uint64_t>(b);
+		const std::int64_t signedB = std::get<std::int64_t>(b);
+		return signedB < 0 ? std::partial_ordering::greater : std::get<std::uint64_t>(a) <=> static_cast<std::uint64_t>(signedB);
+	}
+	auto toDouble = [](const Number &n) { return std::visit([](const auto v) { return static_cast<double>(v); }, n); };
+	return toDouble(a) <=> toDouble(b);
+}
+
+std::string JsonSchema::numberToString(const Number &value)
+{
+	return std::visit([](const auto v) { return std::format("{}", v); }, value);
+}
+
+void JsonSchema::validateNumber(const Node &node, const Number &value, const std::string &path, std::vector<Violation> &violations)
+{
+	if (node.minimum && compare(value, *node.minimum) == std::partial_ordering::less)
+		addViolation(violations, path, std::format("value {} is less than minimum {}", numberToString(value), numberToString(*node.minimum)));
+	if (node.maximum && compare(value, *node.maximum) == std::partial_ordering::greater)
+		addViolation(violations, path, std::format("value {} is greater than maximum {}", numberToString(value), numberToString(*node.maximum)));
+	if (node.exclusiveMinimum && compare(value, *node.exclusiveMinimum) != std::partial_ordering::greater)
+		addViolation(violations, path, std::format("value {} must be greater than {}", numberToString(value), numberToString(*node.exclusiveMinimum)));
+	if (node.exclusiveMaximum && compare(value, *node.exclusiveMaximum) != std::partial_ordering::less)
+		addViolation(violations, path, std::format("value {} must be less than {}", numberToString(value), numberToString(*node.exclusiveMaximum)));
+
+	if (node.multipleOf)
+	{
+		bool multiple;
+		if (!std::holds_alternative<double>(value) && !std::holds_alternative<double>(*node.multipleOf))
+		{
+			// multipleOf > 0: si confrontano i moduli nel dominio degli interi senza segno
+			auto magnitude = [](const Number &n)
+			{
+				if (const std::int64_t *v = std::get_if<std::int64_t>(&n))
+					return *v < 0 ? 0 - static_cast<std::uint64_t>(*v) : static_cast<std::uint64_t>(*v);
+				return std::get<std::uint64_t>(n);
+			};
+			multiple = magnitude(value) % magnitude(*node.multipleOf) == 0;
+		}
+		else
+		{
+			auto toDouble = [](const Number &n) { return std::visit([](const auto v) { return static_cast<double>(v); }, n); };
+			const double quotient = toDouble(value) / toDouble(*node.multipleOf);
+			multiple = std::isfinite(quotient) && std::abs(quotient - std::round(quotient)) <= 1e-9 * std::max(1.0, std::abs(quotient));
+		}
+		if (!multiple)
+			addViolation(violations, path, std::format("value {} is not a multiple of {}", numberToString(value), numberToString(*node.multipleOf)));
+	}
+}
+
+void JsonSchema::validateString(const Node &node, const std::string &value, const std::string &path, std::vector<Violation> &violations)
+{
+	if (node.minLength || node.maxLength)
+	{
+		// la lunghezza di JSON Schema è in code point, non in byte
+		const std::size_t length = std::ranges::count_if(value, [](const char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; });
+		if (node.minLength && length < *node.minLength)
+			addViolation(violations, path, std::format("expected at least {} characters, found {}", *node.minLength, length));
+		if (node.maxLength && length > *node.maxLength)
+			addViolation(violations, path, std::format("expected at most {} characters, found {}", *node.maxLength, length));
+	}
+	if (node.pattern)
+	{
+		try
+		{
+			if (!std::regex_search(value, *node.pattern))
+				addViolation(violations, path, std::format("value does not match pattern '{}'", node.patternSource));
+		}
+		catch (const std::regex_error &e)
+		{
+			// es. error_complexity/error_stack delle implementazioni che limitano la ricerca
+			addViolation(violations, path, std::format("value could not be matched against pattern '{}': {}", node.patternSource, e.what()));
+		}
+	}
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "JSONUtils.h"
+
+// Validatore per un sottoinsieme di JSON Schema. Lo schema viene compilato una sola volta in un albero di
+// controlli; la validazione fa un'unica visita del documento e raccoglie tutte le violazioni, ognuna con il
+// path del campo nello stesso formato di JsonPath (es. "servers[2].port").
+// Un JsonSchema compilato è immutabile e può essere usato da più thread contemporaneamente.
+//
+// Keyword supportate: type, enum, const, required, properties, additionalProperties (bool), propertyNames,
+// minProperties, maxProperties, dependentRequired, items (schema), prefixItems, minItems, maxItems, uniqueItems,
+// contains, minContains, maxContains, minimum, maximum, exclusiveMinimum, exclusiveMaximum (numeri o booleani del
+// draft 4), multipleOf, minLength, maxLength, pattern (ECMAScript, senza backreference con libstdc++).
+// Lo schema false rifiuta qualunque valore. Interi e limiti interi vengono confrontati come interi (anche oltre
+// 2^53), negli altri casi come double; uniqueItems usa l'uguaglianza canonica di JSONUtils::fastEquals.
+// Le altre keyword che impongono vincoli ($ref, allOf, anyOf, oneOf, not, if, patternProperties, dependentSchemas,
+// unevaluatedProperties, ...) non sono supportate e compile lancia std::invalid_argument; le annotazioni
+// (title, description, default, format, ...) vengono ignorate.
+//
+//	static const JsonSchema schema = JsonSchema::compile(JSONUtils::toJson<json>(schemaText));
+//	for (const auto &violation : schema.validate(request))
+//		LOG_WARN("{}: {}", violation.path, violation.message);
+class JsonSchema
+{
+public:
+	struct Violation
+	{
+		std::string path;
+		std::string message;
+	};
+
+	static JsonSchema compile(const nlohmann::json &schema);
+
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	[[nodiscard]] std::vector<Violation> validate(const J &root) const
+	{
+		std::vector<Violation> violations;
+		std::string path;
+		validate(*_root, root, path, violations);
+		return violations;
+	}
+
+	template <typename J>
+	requires std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>
+	[[nodiscard]] bool isValid(const J &root) const
+	{
+		return validate(root).empty();
+	}
+
+private:
+	enum TypeMask : std::uint8_t
+	{
+		TypeNull = 1 << 0,
+		TypeBoolean = 1 << 1,
+		TypeInteger = 1 << 2,
+		TypeNumber = 1 << 3, // include anche gli interi
+		TypeString = 1 << 4,
+		TypeArray = 1 << 5,
+		TypeObject = 1 << 6,
+		TypeAny = 0x7F
+	};
+
+	// numero json nella sua rappresentazione originale
+	using Number = std::variant<std::int64_t, std::uint64_t, double>;
+
+	struct Node
+	{
+		std::uint8_t types = TypeAny; // 0: schema false
+		std::vector<nlohmann::json> enumValues; // anche per "const"
+
+		// numeri
+		std::optional<Number> minimum;
+		std::optional<Number> maximum;
+		std::optional<Number> exclusiveMinimum;
+		std::optional<Number> exclusiveMaximum;
+		std::optional<Number> multipleOf;
+
+		// stringhe
+		std::optional<std::size_t> minLength;
+		std::optional<std::size_t> maxLength;
+		std::optional<std::regex> pattern;
+		std::string patternSource;
+
+		// array, items si applica agli elementi successivi a quelli di prefixItems
+		std::vector<std::unique_ptr<Node>> prefixItems;
+		std::unique_ptr<Node> items;
+		std::optional<std::size_t> minItems;
+		std::optional<std::size_t> maxItems;
+		bool uniqueItems = false;
+		std::unique_ptr<Node> contains;
+		std::size_t minContains = 1;
+		std::optional<std::size_t> maxContains;
+
+		// oggetti, properties è ordinato per chiave
+		std::vector<std::pair<std::string, std::unique_ptr<Node>>> properties;
+		std::vector<std::string> required;
+		std::vector<std::pair<std::string, std::vector<std::string>>> dependentRequired;
+		bool additionalProperties = true;
+		std::unique_ptr<Node> propertyNames;
+		std::optional<std::size_t> minProperties;
+		std::optional<std::size_t> maxProperties;
+	};
+
+	std::shared_ptr<const Node> _root;
+
+	explicit JsonSchema(std::shared_ptr<const Node> root) : _root(std::move(root)) {}
+
+	static std::unique_ptr<Node> compileNode(const nlohmann::json &schema, const std::string &schemaPath);
+	static std::string typesToString(std::uint8_t types);
+
+	template <typename J>
+	static Number toNumber(const J &value)
+	{
+		if (value.is_number_unsigned())
+			return value.template get<std::uint64_t>();
+		if (value.is_number_integer())
+			return value.template get<std::int64_t>();
+		return value.template get<double>();
+	}
+
+	static std::partial_ordering compare(const Number &a, const Number &b);
+	static std::string numberToString(const Number &value);
+
+	template <typename J>
+	static std::uint8_t typeOf(const J &value)
+	{
+		switch (value.type())
+		{
+		case J::value_t::null:
+			return TypeNull;
+		case J::value_t::boolean:
+			return TypeBoolean;
+		case J::value_t::number_integer:
+		case J::value_t::number_unsigned:
+			return TypeInteger | TypeNumber;
+		case J::value_t::number_float:
+		{
+			const double d = value.template get<double>();
+			return std::isfinite(d) && std::floor(d) == d ? TypeInteger | TypeNumber : TypeNumber;
+		}
+		case J::value_t::string:
+			return TypeString;
+		case J::value_t::array:
+			return TypeArray;
+		case J::value_t::object:
+			return TypeObject;
+		default:
+			return 0;
+		}
+	}
+
+	static void addViolation(std::vector<Violation> &violations, const std::string &path, std::string message)
+	{
+		violations.push_back({path.empty() ? "$" : path, std::move(message)});
+	}
+
+	template <typename J>
+	static void validate(const Node &node, const J &value, std::string &path, std::vector<Violation> &violations)
+	{
+		if (node.types == 0)
+		{
+			addViolation(violations, path, "no value is allowed (false schema)");
+			return;
+		}
+
+		const std::uint8_t type = typeOf(value);
+		if ((node.types & type) == 0)
+		{
+			addViolation(violations, path,
+				std::format("expected type {}, found {}", typesToString(node.types), value.type_name()));
+			return;
+		}
+
+		if (!node.enumValues.empty())
+		{
+			bool found;
+			if constexpr (std::is_same_v<J, nlohmann::json>)
+				found = std::ranges::find(node.enumValues, value) != node.enumValues.end();
+			else
+				found = std::ranges::find(node.enumValues, nlohmann::json(value)) != node.enumValues.end();
+			if (!found)
+				addViolation(violations, path, std::format("value {} is not one of the allowed values", JSONUtils::logExcerpt(value, path)));
+		}
+
+		if (type & TypeNumber)
+			validateNumber(node, toNumber(value), path, violations);
+		else if (type == TypeString)
+			validateString(node, value.template get_ref<const std::string &>(), path, violations);
+		else if (type == TypeArray)
+		{
+			if (node.minItems && value.size() < *node.minItems)
+				addViolation(violations, path, std::format("expected at least {} items, found {}", *node.minItems, value.size()));
+			if (node.maxItems && value.size() > *node.maxItems)
+				addViolation(violations, path, std::format("expected at most {} items, found {}", *node.maxItems, value.size()));
+			if (node.items || !node.prefixItems.empty())
+			{
+				const std::size_t pathLength = path.size();
+				std::size_t index = 0;
+				for (const J &item : value)
+				{
+					const Node *itemNode = index < node.prefixItems.size() ? node.prefixItems[index].get() : node.items.get();
+					if (itemNode == nullptr)
+						break;
+					std::format_to(std::back_inserter(path), "[{}]", index++);
+					validate(*itemNode, item, path, violations);
+					path.resize(pathLength);
+				}
+			}
+			if (node.uniqueItems)
+				validateUniqueItems(value, path, violations);
+			if (node.contains)
+			{
+				std::size_t matches = 0;
+				std::vector<Violation> itemViolations;
+				std::string itemPath;
+				for (const J &item : value)
+				{
+					itemViolations.clear();
+					validate(*node.contains, item, itemPath, itemViolations);
+					matches += itemViolations.empty();
+				}
+				if (matches < node.minContains)
+					addViolation(violations, path, std::format("expected at least {} items matching 'contains', found {}", node.minContains, matches));
+				if (node.maxContains && matches > *node.maxContains)
+					addViolation(violations, path, std::format("expected at most {} items matching 'contains', found {}", *node.maxContains, matches));
+			}
+		}
+		else if (type == TypeObject)
+			validateObject(node, value, path, violations);
+	}
+
+	template <typename J>
+	static void validateUniqueItems(const J &value, const std::string &path, std::vector<Violation> &violations)
+	{
+		// ordinati per hash canonico: solo gli elementi con lo stesso hash vengono confrontati
+		std::vector<std::pair<std::uint64_t, std::size_t>> hashes;
+		hashes.reserve(value.size());
+		for (std::size_t index = 0; index < value.size(); index++)
+			hashes.emplace_back(JSONUtils::hash(value[index]), index);
+		std::ranges::sort(hashes);
+		for (std::size_t first = 0; first < hashes.size(); first++)
+		{
+			for (std::size_t second = first + 1; second < hashes.size() && hashes[second].first == hashes[first].first; second++)
+			{
+				if (JSONUtils::fastEquals(value[hashes[first].second], value[hashes[second].second]))
+				{
+					addViolation(violations, path,
+						std::format("expected unique items, items [{}] and [{}] are equal", hashes[first].second, hashes[second].second));
+					return;
+				}
+			}
+		}
+	}
+
+	static void validateNumber(const Node &node, const Number &value, const std::string &path, std::vector<Violation> &violations);
+	static void validateString(const Node &node, const std::string &value, const std::string &path, std::vector<Violation> &violations);
+
+	template <typename J>
+	static void validateObject(const Node &node, const J &value, std::string &path, std::vector<Violation> &violations)
+	{
+		const std::size_t pathLength = path.size();
+		auto appendKey = [&](const std::string_view key)
+		{
+			if (pathLength > 0)
+				path.push_back('.');
+			path.append(key);
+		};
+
+		if (node.minProperties && value.size() < *node.minProperties)
+			addViolation(violations, path, std::format("expected at least {} properties, found {}", *node.minProperties, value.size()));
+		if (node.maxProperties && value.size() > *node.maxProperties)
+			addViolation(violations, path, std::format("expected at most {} properties, found {}", *node.maxProperties, value.size()));
+
+		for (const std::string &field : node.required)
+		{
+			if (!value.contains(field))
+			{
+				appendKey(field);
+				addViolation(violations, path, "missing required field");
+				path.resize(pathLength);
+			}
+		}
+		for (const auto &[dependency, fields] : node.dependentRequired)
+		{
+			if (!value.contains(dependency))
+				continue;
+			for (const std::string &field : fields)
+			{
+				if (!value.contains(field))
+				{
+					appendKey(field);
+					addViolation(violations, path, std::format("missing field required by '{}'", dependency));
+					path.resize(pathLength);
+				}
+			}
+		}
+
+		if (node.properties.empty() && node.additionalProperties && !node.propertyNames)
+			return;
+
+		for (auto it = value.begin(); it != value.end(); ++it)
+		{
+			const std::string &key = it.key();
+			auto property = std::ranges::lower_bound(node.properties, key, {}, [](const auto &p) -> const std::string & { return p.first; });
+			appendKey(key);
+			if (node.propertyNames)
+			{
+				std::vector<Violation> nameViolations;
+				std::string namePath;
+				validate(*node.propertyNames, nlohmann::json(key), namePath, nameViolations);
+				for (Violation &violation : nameViolations)
+					addViolation(violations, path, std::format("invalid property name: {}", violation.message));
+			}
+			if (property != node.properties.end() && property->first == key)
+				validate(*property->second, it.value(), path, violations);
+			else if (!node.additionalProperties)
+				addViolation(violations, path, "additional property not allowed");
+			path.resize(pathLength);
+		}
+	}
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "JSONUtils.h"
+
+// Documento json immutabile con condivisione strutturale: ogni nodo è reference-counted e non viene mai
+// modificato, per cui la copia di un PersistentJson costa O(1) e può essere passata ad altri thread senza
+// sincronizzazione. Le modifiche (set, pushBack, erase, setIn) ritornano un nuovo documento che copia solo
+// i nodi sul percorso dalla radice al nodo modificato, tutti gli altri sottoalberi restano condivisi.
+//
+//	PersistentJson<json> config(JSONUtils::loadConfigurationFile<json>(path));
+//	PersistentJson<json> updated = config.setIn({"log", "level"}, json("debug"));	// config non cambia
+//	int32_t port = updated["api"].as<int32_t>("port", 80);
+//
+// Per nlohmann::json le chiavi degli oggetti restano ordinate (come std::map), per nlohmann::ordered_json
+// resta l'ordine di inserimento.
+template <typename J>
+requires (std::is_same_v<J, nlohmann::json> || std::is_same_v<J, nlohmann::ordered_json>)
+class PersistentJson
+{
+public:
+	using Array = std::vector<PersistentJson>;
+	using Object = std::vector<std::pair<std::string, PersistentJson>>;
+
+	PersistentJson() = default; // null
+
+	PersistentJson(const J &j)
+	{
+		if (j.is_object())
+		{
+			Object members;
+			members.reserve(j.size());
+			for (auto it = j.begin(); it != j.end(); ++it)
+				members.emplace_back(it.key(), PersistentJson(it.value()));
+			_node = std::make_shared<const Node>(std::move(members));
+		}
+		else if (j.is_array())
+		{
+			Array elements;
+			elements.reserve(j.size());
+			for (const J &element : j)
+				elements.emplace_back(element);
+			_node = std::make_shared<const Node>(std::move(elements));
+		}
+		else if (!j.is_null())
+			_node = std::make_shared<const Node>(j);
+	}
+
+	[[nodiscard]] static PersistentJson object() { return PersistentJson(std::make_shared<const Node>(Object{})); }
+	[[nodiscard]] static PersistentJson array() { return PersistentJson(std::make_shared<const Node>(Array{})); }
+
+	[[nodiscard]] J toJson() const
+	{
+		if (!_node)
+			return nullptr;
+		if (const Object *members = std::get_if<Object>(&_node->value))
+		{
+			J root = J::object();
+			for (const auto &[key, value] : *members)
+				root.emplace(key, value.toJson());
+			return root;
+		}
+		if (const Array *elements = std::get_if<Array>(&_node->value))
+		{
+			typename J::array_t values;
+			values.reserve(elements->size());
+			for (const PersistentJson &element : *elements)
+				values.push_back(element.toJson());
+			return J(std::move(values));
+		}
+		return std::get<J>(_node->value);
+	}
+
+	[[nodiscard]] bool is_null() const noexcept { return !_node; }
+	[[nodiscard]] bool is_object() const noexcept { return _node && std::holds_alternative<Object>(_node->value); }
+	[[nodiscard]] bool is_array() const noexcept { return _node && std::holds_alternative<Array>(_node->value); }
+
+	[[nodiscard]] std::size_t size() const noexcept
+	{
+		if (!_node)
+			return 0;
+		if (const Object *members = std::get_if<Object>(&_node->value))
+			return members->size();
+		if (const Array *elements = std::get_if<Array>(&_node->value))
+			return elements->size();
+		return 1;
+	}
+
+	// true se i due documenti condividono lo stesso nodo (confronto O(1), non strutturale)
+	[[nodiscard]] bool sameNode(const PersistentJson &other) const noexcept { return _node == other._node; }
+
+	[[nodiscard]] const Object &members() const
+	{
+		static const Object empty;
+		const Object *members = _node ? std::get_if<Object>(&_node->value) : nullptr;
+		return members ? *members : empty;
+	}
+
+	[[nodiscard]] const Array &elements() const
+	{
+		static const Array empty;
+		const Array *elements = _node ? std::get_if<Array>(&_node->value) : nullptr;
+		return elements ? *elements : empty;
+	}
+
+	[[nodiscard]] const PersistentJson *find(const std::string_view key) const
+	{
+		const Object &m = members();
+		auto it = findMember(m, key);
+		return it != m.end() && it->first == key ? &it->second : nullptr;
+	}
+
+	[[nodiscard]] bool contains(const std::string_view key) const { return find(key) != nullptr; }
+
+	// come JsonPath in modalità Optional: un campo/elemento mancante ritorna null
+	[[nodiscard]] const PersistentJson &operator[](const std::string_view key) const
+	{
+		const PersistentJson *value = find(key);
+		return value ? *value : null();
+	}
+
+	[[nodiscard]] const PersistentJson &operator[](const std::size_t index) const
+	{
+		const Array &e = elements();
+		return index < e.size() ? e[index] : null();
+	}
+
+	// Stessa semantica (conversioni, default, allowedValues, exceptionOnError) di JSONUtils::as, anche per un campo
+	// presente con valore null. I valori scalari vengono letti dal nodo senza copie; per oggetti e array il
+	// sottoalbero viene materializzato solo se T è J (o un altro tipo costruito da un contenitore) oppure per il
+	// messaggio di errore. Per leggere un sottoalbero senza copie usare operator[]
+	template <typename T>
+	[[nodiscard]] T as(std::string_view field = {}, T defaultVal = {}, std::span<const T> allowedValues = {},
+		const bool exceptionOnError = false) const
+	{
+		if (is_null())
+			return JSONUtils::as<T>(leaf(), field, std::move(defaultVal), allowedValues, exceptionOnError);
+
+		const PersistentJson *target = field.empty() ? this : find(field);
+		if (target == nullptr)
+			return JSONUtils::asField<T>(static_cast<const J *>(nullptr), field, std::move(defaultVal), allowedValues, exceptionOnError);
+		if (!target->_node || std::holds_alternative<J>(target->_node->value))
+			return JSONUtils::asField<T>(&target->leaf(), field, std::move(defaultVal), allowedValues, exceptionOnError);
+		// oggetto/array: per T scalare la conversione fallisce comunque e il json serve solo al messaggio di errore
+		const J materialized = target->toJson();
+		return JSONUtils::asField<T>(&materialized, field, std::move(defaultVal), allowedValues, exceptionOnError);
+	}
+
+	// Modifiche: ritornano un nuovo documento, *this resta invariato
+
+	// su un documento null crea un oggetto (come nlohmann::json::operator[])
+	[[nodiscard]] PersistentJson set(const std::string_view key, PersistentJson value) const
+	{
+		if (_node && !is_object())
+			throw std::invalid_argument(std::format("PersistentJson::set: not an object, key: {}", key));
+
+		Object m = members();
+		auto it = findMember(m, key);
+		if (it != m.end() && it->first == key)
+			it->second = std::move(value);
+		else
+			m.emplace(it, std::string(key), std::move(value));
+		return PersistentJson(std::make_shared<const Node>(std::move(m)));
+	}
+
+	[[nodiscard]] PersistentJson set(const std::size_t index, PersistentJson value) const
+	{
+		if (!is_array() || index >= size())
+			throw std::out_of_range(std::format("PersistentJson::set: index {} out of range", index));
+
+		Array e = elements();
+		e[index] = std::move(value);
+		return PersistentJson(std::make_shared<const Node>(std::move(e)));
+	}
+
+	// su un documento null crea un array (come nlohmann::json::push_back)
+	[[nodiscard]] PersistentJson pushBack(PersistentJson value) const
+	{
+		if (_node && !is_array())
+			throw std::invalid_argument("PersistentJson::pushBack: not an array");
+
+		Array e;
+		e.reserve(size() + 1);
+		e.insert(e.end(), elements().begin(), elements().end());
+		e.push_back(std::move(value));
+		return PersistentJson(std::make_shared<const Node>(std::move(e)));
+	}
+
+	[[nodiscard]] PersistentJson erase(const std::string_view key) const
+	{
+		if (!contains(key))
+			return *this;
+
+		Object m = members();
+		m.erase(findMember(m, key));
+		return PersistentJson(std::make_shared<const Node>(std::move(m)));
+	}
+
+	// come JSONUtils::jpath ma in scrittura: gli oggetti intermedi mancanti vengono creati
+	[[nodiscard]] PersistentJson setIn(const std::initializer_list<std::string_view> fields, PersistentJson value) const
+	{
+		return setIn(fields.begin(), fields.end(), std::move(value));
+	}
+
+private:
+	template <typename>
+	friend class PersistentJsonStore;
+
+	struct Node
+	{
+		std::variant<J, Array, Object> value;
+
+		explicit Node(J leaf) : value(std::move(leaf)) {}
+		explicit Node(Array elements) : value(std::move(elements)) {}
+		explicit Node(Object members) : value(std::move(members)) {}
+	};
+
+	std::shared_ptr<const Node> _node;
+
+	explicit PersistentJson(std::shared_ptr<const Node> node) : _node(std::move(node)) {}
+
+	static const PersistentJson &null()
+	{
+		static const PersistentJson value;
+		return value;
+	}
+
+	[[nodiscard]] const J &leaf() const
+	{
+		static const J nullLeaf;
+		return _node ? std::get<J>(_node->value) : nullLeaf;
+	}
+
+	// per nlohmann::json i membri sono ordinati (ricerca binaria), per ordered_json in ordine di inserimento
+	template <typename M>
+	static auto findMember(M &m, const std::string_view key)
+	{
+		if constexpr (std::is_same_v<J, nlohmann::json>)
+			return std::ranges::lower_bound(m, key, {}, [](const auto &member) { return std::string_view(member.first); });
+		else
+			return std::ranges::find(m, key, [](const auto &member) { return std::string_view(member.first); });
+	}
+
+	[[nodiscard]] PersistentJson setIn(const std::string_view *field, const std::string_view *end, PersistentJson value) const
+	{
+		if (field == end)
+			return value;
+		const PersistentJson &child = (*this)[*field];
+		return set(*field, child.setIn(field + 1, end, std::move(value)));
+	}
+};
+
+// Punto di pubblicazione di uno snapshot condiviso tra thread: i lettori fanno load() e lavorano sulla loro
+// copia (O(1)), il writer pubblica una nuova versione con store() o update() senza bloccare i lettori
+template <typename J>
+class PersistentJsonStore
+{
+public:
+	explicit PersistentJsonStore(PersistentJson<J> initial = {}) : _root(std::move(initial._node)) {}
+
+	[[nodiscard]] PersistentJson<J> load() const { return PersistentJson<J>(_root.load()); }
+
+	void store(PersistentJson<J> value) { _root.store(std::move(value._node)); }
+
+	// applica f all'ultima versione finché nessun altro writer l'ha cambiata nel frattempo
+	template <typename F>
+	PersistentJson<J> update(F &&f)
+	{
+		auto current = _root.load();
+		for (;;)
+		{
+			PersistentJson<J> updated = f(PersistentJson<J>(current));
+			if (_root.compare_exchange_weak(current, updated._node))
+				return updated;
+		}
+	}
+
+private:
+	std::atomic<std::shared_ptr<const typename PersistentJson<J>::Node>> _root;
+};